@@ -0,0 +1,814 @@
+#include "model.hpp"
+
+#include "assimp_importer.hpp"
+#include "simd.hpp"
+#include "types.hpp"
+
+#include "assimp/scene.h"
+
+#include "meshoptimizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Timing runs for the importers on synthetic scenes written into the temp
+// directory, build in release for meaningful numbers. Every mode runs in its
+// own process.
+//
+//   asset-bench accessors   packed against interleaved glTF vertex accessors,
+//                           the first take the bulk copy path and the second
+//                           iterateAccessor
+//   asset-bench hierarchy   the ASSIMP node linking pass alone over growing
+//                           deep and wide aiNode trees, fails unless the
+//                           time per node stays flat
+//   asset-bench transforms  full and partial world transform passes over an
+//                           imported hierarchy, fails unless every node
+//                           matches a walk from the roots
+//   asset-bench load-memory <read|mmap>
+//                           peak memory of a FASTGLTF import with its buffer
+//                           read into memory or memory mapped
+//   asset-bench optimize-memory <soa|aos>
+//                           peak memory of optimize_meshes against the
+//                           interleaved copy it used to make
+
+constexpr int      BENCH_REPEATS      = 5;
+constexpr uint32_t GRID_SIDE          = 1024;
+constexpr uint32_t MEMORY_GRID_SIDE   = 2048;
+constexpr uint32_t HIERARCHY_CHAIN    = 256;
+constexpr uint32_t INTERLEAVED_STRIDE = 32;
+
+// largest allowed growth of the time per node from the smallest to the
+// largest hierarchy, a quadratic pass grows by the size ratio of 16
+constexpr double HIERARCHY_GROWTH_LIMIT = 4.0;
+
+using BenchClock = std::chrono::steady_clock;
+
+auto
+get_bench_directory() -> std::filesystem::path
+{
+  std::filesystem::path directory =
+    std::filesystem::temp_directory_path() / "pxd-asset-bench";
+  std::filesystem::create_directories(directory);
+
+  return directory;
+}
+
+void
+write_file(const std::filesystem::path& path, const void* data, size_t size)
+{
+  std::ofstream stream(path, std::ios::binary);
+  stream.write(static_cast<const char*>(data),
+               static_cast<std::streamsize>(size));
+}
+
+void
+write_file(const std::filesystem::path& path, std::string_view text)
+{
+  write_file(path, text.data(), text.size());
+}
+
+template<typename T>
+void
+append_bytes(std::vector<uint8_t>& bytes, const T& value)
+{
+  const auto* first = reinterpret_cast<const uint8_t*>(&value);
+  bytes.insert(bytes.end(), first, first + sizeof(T));
+}
+
+// indices of a triangle grid with side * side vertices
+auto
+get_grid_indices(uint32_t side) -> std::vector<uint32_t>
+{
+  std::vector<uint32_t> indices;
+  indices.reserve(size_t(side - 1) * (side - 1) * 6);
+
+  for (uint32_t y = 0; y + 1 < side; y++) {
+    for (uint32_t x = 0; x + 1 < side; x++) {
+      const uint32_t corner = y * side + x;
+
+      indices.insert(indices.end(),
+                     { corner,
+                       corner + side,
+                       corner + 1,
+                       corner + 1,
+                       corner + side,
+                       corner + side + 1 });
+    }
+  }
+
+  return indices;
+}
+
+// One triangle grid of side * side vertices. Every attribute gets its own
+// buffer view, or they share one view with INTERLEAVED_STRIDE.
+void
+write_grid_scene(const std::filesystem::path& path,
+                 uint32_t                     side,
+                 bool                         interleaved)
+{
+  const std::vector<uint32_t> indices = get_grid_indices(side);
+
+  const uint32_t vertex_count = side * side;
+  const uint32_t index_count  = static_cast<uint32_t>(indices.size());
+
+  std::vector<uint8_t> bytes;
+  bytes.reserve(index_count * 4 + vertex_count * INTERLEAVED_STRIDE);
+
+  for (uint32_t index : indices) {
+    append_bytes(bytes, index);
+  }
+
+  auto position = [&](uint32_t v) {
+    return glm::vec3{ float(v % side), 0.f, float(v / side) };
+  };
+  auto uv = [&](uint32_t v) {
+    return glm::vec2{ float(v % side) / side, float(v / side) / side };
+  };
+
+  const glm::vec3 normal{ 0.f, 1.f, 0.f };
+
+  // packed components only, an aligned glm::vec3 must not leak its padding
+  auto append_vec3 = [&](const glm::vec3& v) {
+    for (int c = 0; c < 3; c++) {
+      append_bytes(bytes, v[c]);
+    }
+  };
+  auto append_vec2 = [&](const glm::vec2& v) {
+    append_bytes(bytes, v.x);
+    append_bytes(bytes, v.y);
+  };
+
+  if (interleaved) {
+    for (uint32_t v = 0; v < vertex_count; v++) {
+      append_vec3(position(v));
+      append_vec3(normal);
+      append_vec2(uv(v));
+    }
+  } else {
+    for (uint32_t v = 0; v < vertex_count; v++) {
+      append_vec3(position(v));
+    }
+    for (uint32_t v = 0; v < vertex_count; v++) {
+      append_vec3(normal);
+    }
+    for (uint32_t v = 0; v < vertex_count; v++) {
+      append_vec2(uv(v));
+    }
+  }
+
+  std::filesystem::path bin_path = path;
+  bin_path.replace_extension(".bin");
+  write_file(bin_path, bytes.data(), bytes.size());
+
+  const std::string index_bytes  = std::to_string(index_count * 4);
+  const std::string vertices     = std::to_string(vertex_count);
+  const std::string vec3_bytes   = std::to_string(vertex_count * 12);
+  const std::string grid_extent  = std::to_string(side - 1);
+  const std::string vertex_start = index_bytes;
+
+  std::string views;
+  std::string offsets[3];
+
+  if (interleaved) {
+    views = "{\"buffer\":0,\"byteOffset\":" + vertex_start +
+            ",\"byteLength\":" +
+            std::to_string(vertex_count * INTERLEAVED_STRIDE) +
+            ",\"byteStride\":" + std::to_string(INTERLEAVED_STRIDE) + "}";
+    offsets[0] = "\"bufferView\":1,\"byteOffset\":0";
+    offsets[1] = "\"bufferView\":1,\"byteOffset\":12";
+    offsets[2] = "\"bufferView\":1,\"byteOffset\":24";
+  } else {
+    views = "{\"buffer\":0,\"byteOffset\":" + vertex_start +
+            ",\"byteLength\":" + vec3_bytes + "},"
+            "{\"buffer\":0,\"byteOffset\":" +
+            std::to_string(index_count * 4 + vertex_count * 12) +
+            ",\"byteLength\":" + vec3_bytes + "},"
+            "{\"buffer\":0,\"byteOffset\":" +
+            std::to_string(index_count * 4 + vertex_count * 24) +
+            ",\"byteLength\":" + std::to_string(vertex_count * 8) + "}";
+    offsets[0] = "\"bufferView\":1";
+    offsets[1] = "\"bufferView\":2";
+    offsets[2] = "\"bufferView\":3";
+  }
+
+  const std::string json =
+    "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,"
+    "\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+    "\"meshes\":[{\"name\":\"grid\",\"primitives\":[{\"attributes\":"
+    "{\"POSITION\":1,\"NORMAL\":2,\"TEXCOORD_0\":3},\"indices\":0}]}],"
+    "\"buffers\":[{\"uri\":\"" +
+    bin_path.filename().string() +
+    "\",\"byteLength\":" + std::to_string(bytes.size()) +
+    "}],"
+    "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" +
+    index_bytes + "}," + views +
+    "],"
+    "\"accessors\":["
+    "{\"bufferView\":0,\"componentType\":5125,\"count\":" +
+    std::to_string(index_count) +
+    ",\"type\":\"SCALAR\"},"
+    "{" +
+    offsets[0] + ",\"componentType\":5126,\"count\":" + vertices +
+    ",\"type\":\"VEC3\",\"min\":[0,0,0],\"max\":[" + grid_extent + ",0," +
+    grid_extent +
+    "]},"
+    "{" +
+    offsets[1] + ",\"componentType\":5126,\"count\":" + vertices +
+    ",\"type\":\"VEC3\"},"
+    "{" +
+    offsets[2] + ",\"componentType\":5126,\"count\":" + vertices +
+    ",\"type\":\"VEC2\"}]}";
+
+  write_file(path, json);
+}
+
+// parent of node i in [1, node_count] of the synthetic hierarchy under root
+// node 0, the first half in chains of HIERARCHY_CHAIN nodes and the second
+// half directly under the root
+auto
+get_hierarchy_parent(uint32_t i, uint32_t node_count) -> uint32_t
+{
+  const bool chain_start = i > node_count / 2 || (i - 1) % HIERARCHY_CHAIN == 0;
+
+  return chain_start ? 0 : i - 1;
+}
+
+// the synthetic hierarchy as an aiNode tree, deleting the root frees it
+auto
+build_hierarchy_tree(uint32_t node_count) -> aiNode*
+{
+  std::vector<aiNode*>              ai_nodes(node_count + 1);
+  std::vector<std::vector<aiNode*>> children(node_count + 1);
+
+  for (uint32_t i = 0; i <= node_count; i++) {
+    ai_nodes[i] = new aiNode("n" + std::to_string(i));
+  }
+
+  for (uint32_t i = 1; i <= node_count; i++) {
+    children[get_hierarchy_parent(i, node_count)].push_back(ai_nodes[i]);
+  }
+
+  for (uint32_t i = 0; i <= node_count; i++) {
+    if (!children[i].empty()) {
+      ai_nodes[i]->addChildren(static_cast<unsigned int>(children[i].size()),
+                               children[i].data());
+    }
+  }
+
+  return ai_nodes[0];
+}
+
+// The synthetic hierarchy with one triangle under the root
+void
+write_hierarchy_scene(const std::filesystem::path& path, uint32_t node_count)
+{
+  std::vector<std::vector<uint32_t>> children(node_count + 1);
+
+  for (uint32_t i = 1; i <= node_count; i++) {
+    children[get_hierarchy_parent(i, node_count)].push_back(i);
+  }
+
+  std::string nodes;
+  nodes.reserve(size_t(node_count) * 32);
+
+  for (uint32_t i = 0; i <= node_count; i++) {
+    nodes += i == 0 ? "{\"mesh\":0," : ",{";
+    nodes += "\"name\":\"n" + std::to_string(i) + "\"";
+
+    if (!children[i].empty()) {
+      nodes += ",\"children\":[";
+
+      for (size_t c = 0; c < children[i].size(); c++) {
+        nodes += (c == 0 ? "" : ",") + std::to_string(children[i][c]);
+      }
+
+      nodes += "]";
+    }
+
+    nodes += "}";
+  }
+
+  std::vector<uint8_t> bytes;
+
+  for (uint32_t index : { 0u, 1u, 2u }) {
+    append_bytes(bytes, index);
+  }
+  for (float component : { 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f }) {
+    append_bytes(bytes, component);
+  }
+
+  std::filesystem::path bin_path = path;
+  bin_path.replace_extension(".bin");
+  write_file(bin_path, bytes.data(), bytes.size());
+
+  const std::string json =
+    "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,"
+    "\"scenes\":[{\"nodes\":[0]}],\"nodes\":[" +
+    nodes +
+    "],"
+    "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":1},"
+    "\"indices\":0}]}],"
+    "\"buffers\":[{\"uri\":\"" +
+    bin_path.filename().string() +
+    "\",\"byteLength\":48}],"
+    "\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":12},"
+    "{\"buffer\":0,\"byteOffset\":12,\"byteLength\":36}],"
+    "\"accessors\":["
+    "{\"bufferView\":0,\"componentType\":5125,\"count\":3,"
+    "\"type\":\"SCALAR\"},"
+    "{\"bufferView\":1,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\","
+    "\"min\":[0,0,0],\"max\":[1,0,1]}]}";
+
+  write_file(path, json);
+}
+
+// best of BENCH_REPEATS imports in milliseconds, negative when one fails
+auto
+time_import(const std::filesystem::path& path, pxd::ass::IMPORTER importer)
+  -> double
+{
+  double best = -1.0;
+
+  for (int i = 0; i < BENCH_REPEATS; i++) {
+    pxd::ass::Model model;
+
+    const BenchClock::time_point start = BenchClock::now();
+
+    if (!model.init(path.string(), importer)) {
+      return -1.0;
+    }
+
+    const double elapsed =
+      std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+        .count();
+
+    best = best < 0.0 ? elapsed : std::min(best, elapsed);
+
+    model.destroy();
+  }
+
+  return best;
+}
+
+auto
+bench_accessors() -> bool
+{
+  const std::filesystem::path directory = get_bench_directory();
+  const double vertex_megabytes =
+    double(GRID_SIDE) * GRID_SIDE * INTERLEAVED_STRIDE / (1024.0 * 1024.0);
+
+  for (bool interleaved : { false, true }) {
+    const std::filesystem::path path =
+      directory / (interleaved ? "grid_interleaved.gltf" : "grid_packed.gltf");
+
+    write_grid_scene(path, GRID_SIDE, interleaved);
+
+    const double milliseconds = time_import(path, pxd::ass::IMPORTER::FASTGLTF);
+
+    if (milliseconds < 0.0) {
+      std::printf("failed to import %s\n", path.string().c_str());
+      return false;
+    }
+
+    std::printf("%-24s %8.2f ms  %8.1f MB/s of vertex data\n",
+                interleaved ? "interleaved (iterate)" : "packed (bulk copy)",
+                milliseconds,
+                vertex_megabytes / (milliseconds / 1000.0));
+  }
+
+  return true;
+}
+
+auto
+bench_hierarchy() -> bool
+{
+  double first_per_node = -1.0;
+  bool   linear         = true;
+
+  for (uint32_t node_count : { 4096u, 16384u, 65536u }) {
+    aiNode* root = build_hierarchy_tree(node_count);
+
+    double best         = -1.0;
+    size_t linked_nodes = 0;
+
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+      pxd::ass::AssimpImport          importer;
+      std::vector<pxd::ass::MeshNode> nodes;
+      std::vector<uint32_t>           parent_nodes;
+
+      const BenchClock::time_point start = BenchClock::now();
+      importer.process_hierarchy(root, nodes, parent_nodes);
+      const double elapsed =
+        std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+          .count();
+
+      best         = best < 0.0 ? elapsed : std::min(best, elapsed);
+      linked_nodes = nodes.size();
+    }
+
+    delete root;
+
+    if (linked_nodes != node_count + 1) {
+      std::printf("linked %zu of %u nodes\n", linked_nodes, node_count + 1);
+      return false;
+    }
+
+    const double per_node = best * 1e6 / double(linked_nodes);
+
+    std::printf("%7zu nodes %10.3f ms  %8.1f ns per node\n",
+                linked_nodes,
+                best,
+                per_node);
+
+    if (first_per_node < 0.0) {
+      first_per_node = per_node;
+    } else if (per_node > first_per_node * HIERARCHY_GROWTH_LIMIT) {
+      linear = false;
+    }
+  }
+
+  if (!linear) {
+    std::printf("time per node grew more than %.1fx, linking is not linear\n",
+                HIERARCHY_GROWTH_LIMIT);
+  }
+
+  return linear;
+}
+
+// true when every reachable node's world transform is exactly root times the
+// chain of local transforms above it, multiplied the same way the model does
+auto
+check_world_transforms(const pxd::ass::Model& model, const glm::mat4& root)
+  -> bool
+{
+  std::vector<std::pair<uint32_t, glm::mat4>> node_stack;
+
+  for (uint32_t node_index : model.parent_nodes) {
+    node_stack.push_back({ node_index, root });
+  }
+
+  while (!node_stack.empty()) {
+    auto [node_index, parent_matrix] = node_stack.back();
+    node_stack.pop_back();
+
+    const pxd::ass::MeshNode& node = model.nodes[node_index];
+
+    glm::mat4 world;
+    pxd::ass::multiply_mat4(
+      &parent_matrix[0][0], &node.local_transform[0][0], &world[0][0]);
+
+    if (std::memcmp(&world, &node.world_transform, sizeof(glm::mat4)) != 0) {
+      return false;
+    }
+
+    for (uint32_t child : node.children) {
+      node_stack.push_back({ child, world });
+    }
+  }
+
+  return true;
+}
+
+auto
+bench_transforms() -> bool
+{
+  const std::filesystem::path directory = get_bench_directory();
+
+  for (uint32_t node_count : { 10000u, 100000u }) {
+    const std::filesystem::path path =
+      directory / ("transforms_" + std::to_string(node_count) + ".gltf");
+
+    write_hierarchy_scene(path, node_count);
+
+    pxd::ass::Model model;
+
+    if (!model.init(path.string(), pxd::ass::IMPORTER::FASTGLTF)) {
+      std::printf("failed to import %s\n", path.string().c_str());
+      return false;
+    }
+
+    // a small shear and offset per node, so a wrong parent or order changes
+    // the result
+    for (uint32_t i = 0; i < model.nodes.size(); i++) {
+      glm::mat4 local{ 1.f };
+      local[1][0] = 0.001f * float(i % 5);
+      local[3][0] = 0.5f * float(i % 7);
+      local[3][1] = 1.f;
+
+      model.set_local_transform(i, local);
+    }
+
+    glm::mat4 root{ 1.f };
+    root[3][2] = 10.f;
+
+    double full_pass = -1.0;
+
+    for (int r = 0; r < BENCH_REPEATS; r++) {
+      const BenchClock::time_point start = BenchClock::now();
+      model.set_transform(root);
+      const double elapsed =
+        std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+          .count();
+
+      full_pass = full_pass < 0.0 ? elapsed : std::min(full_pass, elapsed);
+    }
+
+    if (!check_world_transforms(model, root)) {
+      std::printf("%u nodes: full pass does not match\n", node_count);
+      return false;
+    }
+
+    // every 64th node moves, the subtrees below them are recomputed
+    glm::mat4 moved{ 1.f };
+    moved[3][1] = 2.f;
+
+    for (uint32_t i = 0; i < model.nodes.size(); i += 64) {
+      model.set_local_transform(i, moved);
+    }
+
+    const BenchClock::time_point start = BenchClock::now();
+    model.update_transforms();
+    const double partial_pass =
+      std::chrono::duration<double, std::milli>(BenchClock::now() - start)
+        .count();
+
+    if (!check_world_transforms(model, root)) {
+      std::printf("%u nodes: partial update does not match\n", node_count);
+      return false;
+    }
+
+    std::printf("%7zu nodes  full %8.3f ms  %6.1f ns per node  "
+                "partial %8.3f ms\n",
+                model.nodes.size(),
+                full_pass,
+                full_pass * 1e6 / double(model.nodes.size()),
+                partial_pass);
+  }
+
+  return true;
+}
+
+// Peak resident and private memory from construction on. Private memory
+// leaves out file backed pages like a mapping of the scene, which the OS can
+// drop and reload at any time. It is sampled every millisecond and only
+// available on Linux, elsewhere it stays 0.
+class MemorySampler
+{
+public:
+  MemorySampler()
+    : baseline(get_private_memory())
+    , sampler([this] {
+      while (!stopped) {
+        peak_private = std::max(peak_private.load(), get_private_memory());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    })
+  {
+  }
+
+  ~MemorySampler() { stop(); }
+
+  void stop()
+  {
+    stopped = true;
+
+    if (sampler.joinable()) {
+      sampler.join();
+    }
+  }
+
+  // private memory allocated on top of what was in use at construction
+  auto get_peak_private() const -> size_t
+  {
+    return peak_private > baseline ? peak_private - baseline : 0;
+  }
+
+  static auto get_peak_resident() -> size_t
+  {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+  }
+
+  static auto get_private_memory() -> size_t
+  {
+#if defined(__linux__)
+    size_t total_pages    = 0;
+    size_t resident_pages = 0;
+    size_t shared_pages   = 0;
+
+    std::ifstream statm("/proc/self/statm");
+    statm >> total_pages >> resident_pages >> shared_pages;
+
+    return (resident_pages - shared_pages) *
+           static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+  }
+
+private:
+  size_t              baseline     = 0;
+  std::atomic<size_t> peak_private = 0;
+  std::atomic<bool>   stopped      = false;
+  std::thread         sampler;
+};
+
+void
+print_memory(std::string_view label, const MemorySampler& sampler)
+{
+  constexpr double MEGABYTE = 1024.0 * 1024.0;
+
+  std::printf("%-8s peak resident %8.1f MB  peak private %8.1f MB\n",
+              std::string(label).c_str(),
+              double(MemorySampler::get_peak_resident()) / MEGABYTE,
+              double(sampler.get_peak_private()) / MEGABYTE);
+}
+
+// Imports a grid whose buffer is about 224 MB with the buffer read into
+// memory or memory mapped. The mapped import should peak close to the mesh
+// data it produces, the read one holds a private copy of the buffer on top.
+auto
+bench_load_memory(std::string_view variant) -> bool
+{
+  const std::filesystem::path path = get_bench_directory() / "grid.gltf";
+  write_grid_scene(path, MEMORY_GRID_SIDE, false);
+
+  pxd::ass::ImportOptions options;
+  options.memory_map = variant == "mmap";
+
+  pxd::ass::Model model;
+  MemorySampler   sampler;
+
+  if (!model.init(path.string(), pxd::ass::IMPORTER::FASTGLTF, options)) {
+    std::printf("failed to import %s\n", path.string().c_str());
+    return false;
+  }
+
+  sampler.stop();
+  print_memory(variant, sampler);
+
+  size_t mesh_bytes = 0;
+
+  for (const pxd::ass::Mesh& mesh : model.meshes) {
+    mesh_bytes += mesh.indices.size() * sizeof(uint32_t) +
+                  mesh.positions.size() * sizeof(glm::vec3) +
+                  mesh.normals.size() * sizeof(glm::vec3) +
+                  mesh.uvs.size() * sizeof(glm::vec2);
+  }
+
+  std::printf("%-8s mesh data %8.1f MB\n",
+              "",
+              double(mesh_bytes) / (1024.0 * 1024.0));
+
+  return true;
+}
+
+// the optimize pass before it moved to the SoA streams, one interleaved copy
+// in, one remapped copy out and the streams split back from it
+void
+optimize_mesh_interleaved(pxd::ass::Mesh& mesh)
+{
+  const size_t index_count    = mesh.indices.size();
+  const size_t total_vertices = mesh.positions.size();
+
+  std::vector<pxd::ass::Vertex> temp_vertices = mesh.get_AoS();
+  std::vector<unsigned int>     remap(index_count);
+
+  const size_t vertex_count =
+    meshopt_generateVertexRemap(&remap[0],
+                                mesh.indices.data(),
+                                index_count,
+                                &temp_vertices[0],
+                                total_vertices,
+                                sizeof(pxd::ass::Vertex));
+
+  std::vector<pxd::ass::Vertex> target_vertices(vertex_count);
+
+  meshopt_remapIndexBuffer(
+    mesh.indices.data(), mesh.indices.data(), index_count, &remap[0]);
+  meshopt_remapVertexBuffer(target_vertices.data(),
+                            &temp_vertices[0],
+                            total_vertices,
+                            sizeof(pxd::ass::Vertex),
+                            &remap[0]);
+  meshopt_optimizeVertexCache(
+    mesh.indices.data(), mesh.indices.data(), index_count, vertex_count);
+  meshopt_optimizeOverdraw(mesh.indices.data(),
+                           mesh.indices.data(),
+                           index_count,
+                           &target_vertices[0].pos.x,
+                           vertex_count,
+                           sizeof(pxd::ass::Vertex),
+                           1.05f);
+  meshopt_optimizeVertexFetch(target_vertices.data(),
+                              mesh.indices.data(),
+                              index_count,
+                              target_vertices.data(),
+                              vertex_count,
+                              sizeof(pxd::ass::Vertex));
+
+  mesh.from_AoS(target_vertices);
+}
+
+auto
+bench_optimize_memory(std::string_view variant) -> bool
+{
+  const uint32_t vertex_count = MEMORY_GRID_SIDE * MEMORY_GRID_SIDE;
+
+  pxd::ass::Model model;
+  pxd::ass::Mesh& mesh = model.meshes.emplace_back();
+
+  mesh.indices = get_grid_indices(MEMORY_GRID_SIDE);
+  mesh.positions.resize(vertex_count);
+  mesh.normals.assign(vertex_count, glm::vec3{ 0.f, 1.f, 0.f });
+  mesh.uvs.resize(vertex_count);
+
+  for (uint32_t v = 0; v < vertex_count; v++) {
+    const float x = float(v % MEMORY_GRID_SIDE);
+    const float z = float(v / MEMORY_GRID_SIDE);
+
+    mesh.positions[v] = glm::vec3{ x, 0.f, z };
+    mesh.uvs[v]       = glm::vec2{ x / MEMORY_GRID_SIDE, z / MEMORY_GRID_SIDE };
+  }
+
+  mesh.submeshes.push_back({ .index_offset  = 0,
+                             .index_count   = uint32_t(mesh.indices.size()),
+                             .vertex_offset = 0,
+                             .vertex_count  = vertex_count });
+
+  // only what the pass allocates on top of the mesh is of interest
+  MemorySampler sampler;
+
+  if (variant == "soa") {
+    model.optimize_meshes();
+  } else {
+    optimize_mesh_interleaved(mesh);
+  }
+
+  sampler.stop();
+  print_memory(variant, sampler);
+
+  return true;
+}
+
+int
+main(int argc, char** argv)
+{
+  const std::string_view mode    = argc > 1 ? argv[1] : "";
+  const std::string_view variant = argc > 2 ? argv[2] : "";
+
+  bool succeeded = false;
+
+  if (mode == "accessors") {
+    succeeded = bench_accessors();
+  } else if (mode == "hierarchy") {
+    succeeded = bench_hierarchy();
+  } else if (mode == "transforms") {
+    succeeded = bench_transforms();
+  } else if (mode == "load-memory" &&
+             (variant == "read" || variant == "mmap")) {
+    succeeded = bench_load_memory(variant);
+  } else if (mode == "optimize-memory" &&
+             (variant == "soa" || variant == "aos")) {
+    succeeded = bench_optimize_memory(variant);
+  } else {
+    std::printf("usage: asset-bench <accessors|hierarchy|transforms>\n"
+                "       asset-bench load-memory <read|mmap>\n"
+                "       asset-bench optimize-memory <soa|aos>\n");
+  }
+
+  std::error_code error;
+  std::filesystem::remove_all(
+    std::filesystem::temp_directory_path() / "pxd-asset-bench", error);
+
+  return succeeded ? 0 : 1;
+}
@@ -10,21 +10,26 @@ namespace pxd::ass {
 class AssimpImport : public IImporter
 {
 public:
-  virtual auto init(std::string_view&                           filepath,
-                    absl::flat_hash_map<std::string, Mesh>&     meshes,
-                    absl::flat_hash_map<std::string, MeshNode>& nodes,
-                    std::vector<MeshNode*>& parent_nodes) -> bool override;
+  virtual auto init(std::string_view&      filepath,
+                    const ImportOptions&   options,
+                    std::vector<Mesh>&     meshes,
+                    std::vector<MeshNode>& nodes,
+                    std::vector<uint32_t>& parent_nodes) -> bool override;
+
+  // walks the tree under root once in pre-order and appends a linked
+  // MeshNode for every aiNode, nodes without a parent go into parent_nodes.
+  // Public so the hierarchy pass can be timed apart from parsing.
+  void process_hierarchy(aiNode*                root,
+                         std::vector<MeshNode>& nodes,
+                         std::vector<uint32_t>& parent_nodes);
 
 private:
-  void process_node(aiNode*                                     node,
-                    const aiScene*                              scene,
-                    absl::flat_hash_map<std::string, Mesh>&     meshes,
-                    absl::flat_hash_map<std::string, MeshNode>& nodes);
+  void process_node(aiNode*                node,
+                    uint32_t               parent_index,
+                    std::vector<MeshNode>& nodes);
   auto process_mesh(aiMesh* mesh, const aiScene* scene) -> Mesh;
-  void assign_children(aiNode*                                     root_node,
-                       absl::flat_hash_map<std::string, MeshNode>& nodes);
-  void add_parents(absl::flat_hash_map<std::string, MeshNode>& nodes,
-                   std::vector<MeshNode*>&                     parent_nodes);
+  void add_parents(std::vector<MeshNode>& nodes,
+                   std::vector<uint32_t>& parent_nodes);
 };
 
 }
\ No newline at end of file
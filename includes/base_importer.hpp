@@ -7,13 +7,32 @@ namespace pxd::ass {
 struct Mesh;
 struct MeshNode;
 
+struct ImportOptions
+{
+  // worker threads used while decoding meshes, 1 keeps the import on the
+  // calling thread and 0 uses every hardware thread
+  uint32_t thread_count = 1;
+  // read the scene file and its external buffers through memory mappings
+  // instead of copying them into heap memory, only used by FASTGLTF
+  bool memory_map = false;
+  // bound meshes with the smaller of Ritter's sphere and the aabb sphere
+  // instead of the aabb sphere alone. The tight sphere has its own
+  // sphere_center, callers pairing sphere_radius with the aabb center must
+  // leave this off.
+  bool tight_bounding_spheres = false;
+  // keep a single copy of meshes with identical geometry and point every node
+  // at it, the names of dropped meshes resolve to the kept copy
+  bool deduplicate_meshes = false;
+};
+
 class IImporter
 {
 public:
-  virtual auto init(std::string_view&                           filepath,
-                    absl::flat_hash_map<std::string, Mesh>&     meshes,
-                    absl::flat_hash_map<std::string, MeshNode>& nodes,
-                    std::vector<MeshNode*>& parent_nodes) -> bool = 0;
+  virtual auto init(std::string_view&      filepath,
+                    const ImportOptions&   options,
+                    std::vector<Mesh>&     meshes,
+                    std::vector<MeshNode>& nodes,
+                    std::vector<uint32_t>& parent_nodes) -> bool = 0;
 };
 
 } // namespace pxd::ass
\ No newline at end of file
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <vector>
+
+namespace pxd::ass {
+
+// Six planes facing inwards, a point p is inside a plane when
+// dot(plane.xyz, p) + plane.w >= 0. The planes are normalized, so the same
+// value is the signed distance used by sphere tests.
+struct Frustum
+{
+  glm::vec4 planes[6];
+
+  // extracts the planes of a column-major view projection matrix, the depth
+  // range follows GLM_FORCE_DEPTH_ZERO_TO_ONE
+  static auto from_matrix(const glm::mat4& view_projection) -> Frustum;
+};
+
+// World space spheres and aabbs of a list of instances in SoA layout for the
+// batched frustum_cull kernel. The owner decides the slot order and keeps the
+// slots up to date, every slot is transformed once per change.
+class InstanceBounds
+{
+public:
+  void resize(size_t count);
+  void clear();
+
+  // transforms local_bounds into world space and stores it in slot, the
+  // sphere radius grows with the largest axis scale of the transform
+  void update(size_t           slot,
+              const glm::mat4& world_transform,
+              const Bounds&    local_bounds);
+
+  auto get_aabb_min(size_t slot) const -> glm::vec3
+  {
+    return { aabb_center_x[slot] - aabb_extent_x[slot],
+             aabb_center_y[slot] - aabb_extent_y[slot],
+             aabb_center_z[slot] - aabb_extent_z[slot] };
+  }
+  auto get_aabb_max(size_t slot) const -> glm::vec3
+  {
+    return { aabb_center_x[slot] + aabb_extent_x[slot],
+             aabb_center_y[slot] + aabb_extent_y[slot],
+             aabb_center_z[slot] + aabb_extent_z[slot] };
+  }
+
+  // replaces out_visible with every slot whose sphere and aabb are not fully
+  // outside the frustum, in ascending order
+  void cull(const Frustum& frustum, std::vector<uint32_t>& out_visible) const;
+
+  auto size() const -> size_t { return count; }
+
+private:
+  size_t count = 0;
+
+  // padded to a multiple of 8 so the kernel never reads past the end
+  std::vector<float> sphere_x      = {};
+  std::vector<float> sphere_y      = {};
+  std::vector<float> sphere_z      = {};
+  std::vector<float> sphere_radius = {};
+  std::vector<float> aabb_center_x = {};
+  std::vector<float> aabb_center_y = {};
+  std::vector<float> aabb_center_z = {};
+  std::vector<float> aabb_extent_x = {};
+  std::vector<float> aabb_extent_y = {};
+  std::vector<float> aabb_extent_z = {};
+};
+
+} // namespace pxd::ass
@@ -16,16 +16,18 @@ struct MeshNode;
 class FastGltfImport : public IImporter
 {
 public:
-  virtual auto init(std::string_view&                           filepath,
-                    absl::flat_hash_map<std::string, Mesh>&     meshes,
-                    absl::flat_hash_map<std::string, MeshNode>& nodes,
-                    std::vector<MeshNode*>& parent_nodes) -> bool override;
+  virtual auto init(std::string_view&      filepath,
+                    const ImportOptions&   options,
+                    std::vector<Mesh>&     meshes,
+                    std::vector<MeshNode>& nodes,
+                    std::vector<uint32_t>& parent_nodes) -> bool override;
 
 private:
   void load_indices(fastgltf::Asset&     gltf,
                     fastgltf::Primitive& p,
                     Mesh&                new_mesh,
-                    size_t               initial_vertex);
+                    size_t               initial_vertex,
+                    size_t               initial_index);
   void load_positions(fastgltf::Asset&     gltf,
                       fastgltf::Primitive& p,
                       Mesh&                new_mesh,
@@ -38,11 +40,7 @@ private:
                 fastgltf::Primitive& p,
                 Mesh&                new_mesh,
                 size_t               initial_vertex);
-  void calculate_bounds(Mesh& new_mesh, size_t initial_vertex);
-  void assign_transforms(absl::flat_hash_map<std::string, MeshNode>& _nodes,
-                         absl::flat_hash_map<std::string, Mesh>&     _meshes,
-                         std::vector<std::string>& _mesh_names,
-                         std::vector<std::string>& _node_names,
-                         fastgltf::Asset&          gltf);
+  void assign_transforms(std::vector<MeshNode>& _nodes,
+                         fastgltf::Asset&       gltf);
 };
 }
\ No newline at end of file
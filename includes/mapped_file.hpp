@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace pxd::ass {
+
+// Read-only view of a whole file through the OS page cache. The mapping is
+// private, writes land in copy-on-write pages and never reach the file.
+class MappedFile
+{
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&)            = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  // padding is the number of zeroed bytes that must be readable past the end
+  // of the file, parsers like simdjson read a little past their input
+  auto open(const std::filesystem::path& path, size_t padding = 0) -> bool;
+  void close();
+
+  // hints the OS that the mapping is going to be read front to back
+  void advise_sequential();
+
+  auto data() const -> uint8_t* { return m_data; }
+  auto size() const -> size_t { return m_size; }
+  auto is_open() const -> bool { return m_data != nullptr; }
+
+private:
+  uint8_t* m_data        = nullptr;
+  size_t   m_size        = 0;
+  size_t   m_mapped_size = 0;
+};
+
+} // namespace pxd::ass
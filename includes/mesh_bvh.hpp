@@ -0,0 +1,123 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace pxd::ass {
+
+constexpr uint32_t MESH_BVH_MAX_LEAF_SIZE = 8;
+// deeper than this minus 32 levels the surface area heuristic gives way to
+// even splits, so traversal stacks have a fixed size
+constexpr uint32_t MESH_BVH_MAX_DEPTH = 96;
+// ranges above this many triangles are split with every worker, smaller ones
+// become subtrees that are built side by side
+constexpr size_t MESH_BVH_TASK_TRIANGLES = 64 * 1024;
+
+constexpr uint32_t RAY_PACKET_SIZE = 8;
+
+// direction does not have to be normalized, t is measured in its length
+struct Ray
+{
+  glm::vec3 origin;
+  glm::vec3 direction;
+  float     t_min = 0.f;
+  float     t_max = std::numeric_limits<float>::max();
+};
+
+// triangle indexes Mesh::indices in steps of 3, u and v are the barycentric
+// weights of its second and third corner
+struct RayHit
+{
+  float    t        = std::numeric_limits<float>::max();
+  float    u        = 0.f;
+  float    v        = 0.f;
+  uint32_t triangle = INVALID_INDEX;
+};
+
+// RAY_PACKET_SIZE rays in SoA layout, a lane with t_min > t_max is inactive
+struct RayPacket
+{
+  float origin_x[RAY_PACKET_SIZE];
+  float origin_y[RAY_PACKET_SIZE];
+  float origin_z[RAY_PACKET_SIZE];
+  float direction_x[RAY_PACKET_SIZE];
+  float direction_y[RAY_PACKET_SIZE];
+  float direction_z[RAY_PACKET_SIZE];
+  float t_min[RAY_PACKET_SIZE];
+  float t_max[RAY_PACKET_SIZE];
+};
+
+// lanes that missed or were inactive keep triangle at INVALID_INDEX
+struct RayPacketHit
+{
+  float    t[RAY_PACKET_SIZE];
+  float    u[RAY_PACKET_SIZE];
+  float    v[RAY_PACKET_SIZE];
+  uint32_t triangle[RAY_PACKET_SIZE];
+};
+
+struct ClosestPoint
+{
+  glm::vec3 point;
+  float     distance2 = std::numeric_limits<float>::max();
+  uint32_t  triangle  = INVALID_INDEX;
+};
+
+// a leaf when triangle_count is not 0, it covers the triangles
+// [first, first + triangle_count) in leaf order. Otherwise the children are
+// first and first + 1.
+struct MeshBvhNode
+{
+  glm::vec3 aabb_min;
+  uint32_t  first;
+  glm::vec3 aabb_max;
+  uint32_t  triangle_count;
+};
+
+// Triangle bounding volume hierarchy of one mesh, split with a binned surface
+// area heuristic. It keeps its own copy of the triangles, but changing the
+// mesh's positions or indices invalidates it.
+class MeshBvh
+{
+public:
+  // the top levels of large meshes are binned by thread_count workers and
+  // the remaining subtrees are built in parallel, the tree is the same for
+  // every thread_count
+  void build(std::span<const glm::vec3> positions,
+             std::span<const uint32_t>  indices,
+             uint32_t                   thread_count = 1);
+  void clear();
+
+  // nearest hit in [t_min, t_max]
+  auto intersect(const Ray& ray, RayHit& out_hit) const -> bool;
+  // stops at the first hit in [t_min, t_max], for visibility tests
+  auto occluded(const Ray& ray) const -> bool;
+  // nearest hit of every active lane, the lanes traverse the tree together
+  void intersect(const RayPacket& packet, RayPacketHit& out_hits) const;
+
+  // nearest point on the surface no further than max_distance
+  auto closest_point(const glm::vec3& point,
+                     float            max_distance,
+                     ClosestPoint&    out_closest) const -> bool;
+
+  auto empty() const -> bool { return nodes.empty(); }
+
+  auto get_nodes() const -> std::span<const MeshBvhNode> { return nodes; }
+
+private:
+  auto traverse(const Ray& ray, bool any_hit, RayHit& out_hit) const -> bool;
+
+  std::vector<MeshBvhNode> nodes = {};
+
+  // first corner and the two edges leaving it of every triangle in leaf
+  // order, and the triangle in Mesh::indices each of them came from
+  std::vector<glm::vec3> triangle_corners = {};
+  std::vector<glm::vec3> triangle_edges1  = {};
+  std::vector<glm::vec3> triangle_edges2  = {};
+  std::vector<uint32_t>  triangle_indices = {};
+};
+
+} // namespace pxd::ass
@@ -1,13 +1,41 @@
 #pragma once
 
 #include "../third-party/PXD-STL/includes/absl/flat_hash_map.hpp"
-#include "../third-party/glm/glm/mat4x4.hpp"
-#include "../third-party/glm/glm/vec4.hpp"
+#include "base_importer.hpp"
+#include "scene_bvh.hpp"
+#include "types.hpp"
+
+#include <span>
 
 namespace pxd::ass {
 
-struct Mesh;
-struct MeshNode;
+// transparent hashing lets the name tables be queried with std::string_view
+// without building a temporary std::string
+struct NameHash
+{
+  using is_transparent = void;
+
+  auto operator()(std::string_view name) const -> size_t
+  {
+    return absl::Hash<std::string_view>{}(name);
+  }
+};
+
+struct NameEq
+{
+  using is_transparent = void;
+
+  auto operator()(std::string_view lhs, std::string_view rhs) const -> bool
+  {
+    return lhs == rhs;
+  }
+};
+
+using NameLookup = absl::flat_hash_map<std::string, uint32_t, NameHash, NameEq>;
+
+// index count above which optimize_meshes splits a mesh's vertex cache and
+// overdraw passes into chunks of this size, kept a multiple of 3
+constexpr size_t OPTIMIZE_CHUNK_INDEX_COUNT = 3 * 256 * 1024;
 
 enum class IMPORTER : uint8_t
 {
@@ -17,22 +45,127 @@ enum class IMPORTER : uint8_t
 
 struct Model
 {
-  auto init(std::string_view filepath, IMPORTER importer) -> bool;
+  auto init(std::string_view     filepath,
+            IMPORTER             importer,
+            const ImportOptions& options = {}) -> bool;
   auto destroy() -> bool;
 
-  void optimize_meshes();
+  // runs the meshoptimizer pipeline on every mesh, independent meshes and the
+  // index chunks of very large meshes are spread over thread_count workers,
+  // 0 uses every hardware thread. The result does not depend on thread_count.
+  void optimize_meshes(uint32_t thread_count = 1);
+
+  // runs Mesh::generate_lods on every mesh. optimize_meshes reorders the
+  // vertices and drops existing lods, so lods are generated after it.
+  void generate_lods(std::span<const LodTarget> targets,
+                     uint32_t                   thread_count = 1);
+
+  // runs Mesh::build_meshlets on every mesh, optimize_meshes drops existing
+  // meshlets as well
+  void build_meshlets(uint32_t thread_count  = 1,
+                      size_t   max_vertices  = MESHLET_MAX_VERTICES,
+                      size_t   max_triangles = MESHLET_MAX_TRIANGLES);
 
-  auto get_mesh_w_name(const std::string& mesh_name, Mesh& mesh) -> bool;
-  auto check_mesh_w_name(const std::string& mesh_name) -> bool;
+  // runs Mesh::build_bvh on every mesh, small meshes side by side and large
+  // ones with every worker in turn. optimize_meshes drops existing bvhs.
+  void build_mesh_bvhs(uint32_t thread_count = 1);
+
+  // encodes or decodes the geometry of every mesh, see Mesh::compress.
+  // Compressed meshes are skipped by optimize_meshes.
+  auto compress_meshes(uint32_t thread_count = 1) -> bool;
+  auto decompress_meshes(uint32_t thread_count = 1) -> bool;
+
+  auto get_mesh_w_name(std::string_view mesh_name, Mesh& mesh) -> bool;
+  auto check_mesh_w_name(std::string_view mesh_name) const -> bool;
+
+  // lookups without copies or temporary strings, nullptr or INVALID_INDEX
+  // when there is no mesh with that name
+  auto find_mesh(std::string_view mesh_name) -> Mesh*;
+  auto find_mesh(std::string_view mesh_name) const -> const Mesh*;
+  auto find_mesh_index(std::string_view mesh_name) const -> uint32_t;
+  // resolves every name into the matching slot of out_indices, which has to
+  // be at least as long as mesh_names
+  void find_mesh_indices(std::span<const std::string_view> mesh_names,
+                         std::span<uint32_t>               out_indices) const;
 
   void set_transform(const glm::mat4x4& new_transform);
 
-  std::vector<Mesh> get_meshes();
+  // changes one node's local transform and marks its subtree dirty, nothing is
+  // recomputed until update_transforms is called
+  void set_local_transform(uint32_t node_index, const glm::mat4& transform);
+  // recomputes world transforms of the dirty subtrees only
+  void update_transforms();
+
+  // rebuilds the scene bvh and its instance bounds from the current mesh
+  // bounds and world transforms, init builds them once. Changed mesh bounds or
+  // node meshes need a rebuild.
+  void build_scene_bvh();
+  // Transform changes only record which nodes moved, the queries below refit
+  // the scene bvh over those nodes before they run, transforming each moved
+  // instance once for both queries. Calling this refits it right away instead.
+  void refit_scene_bvh();
+  // appends the (node, mesh) instances whose world aabb touches the frustum
+  void query_frustum(const Frustum&             frustum,
+                     std::vector<MeshInstance>& out_instances);
+  // tests every instance's sphere and aabb against the frustum in one flat
+  // SIMD pass, out_visible receives indices into get_instances(). Faster than
+  // query_frustum when most of the scene is visible.
+  void cull_instances(const Frustum&         frustum,
+                      std::vector<uint32_t>& out_visible);
+  auto get_instances() const -> std::span<const MeshInstance>;
+
+  // views over the stored meshes, nothing is copied
+  auto get_meshes() -> std::span<Mesh>;
+  auto get_meshes() const -> std::span<const Mesh>;
+
+  // Hash of meshes, nodes and parent_nodes in their stored order, with a fixed
+  // seed so it can be compared across runs and machines. It covers names,
+  // geometry streams, submesh ranges and materials, links and local
+  // transforms. Two imports of a file with the same importer and options
+  // hash equal. Compressed meshes hash their released streams, so compare
+  // models in the same compression state.
+  auto get_content_hash() const -> uint64_t;
 
-  absl::flat_hash_map<std::string, Mesh>        meshes       = {};
-  absl::flat_hash_map<std::string, MeshNode>    nodes        = {};
-  std::vector<MeshNode*>                        parent_nodes = {};
+  // nodes and meshes link to each other with indices into these vectors, so a
+  // Model can be moved or copied without relinking.
+  // The order always follows the source file and never the thread count:
+  // meshes are in file order (deduplication keeps the first copy of each),
+  // FASTGLTF nodes are in file order and ASSIMP nodes in hierarchy pre-order,
+  // parent_nodes is sorted by node index. Importing the same file twice gives
+  // identical vectors.
+  std::vector<Mesh>     meshes       = {};
+  std::vector<MeshNode> nodes        = {};
+  std::vector<uint32_t> parent_nodes = {};
+
+  // name lookup side tables, the first mesh or node with a name wins. Their
+  // iteration order is unspecified, use them for lookups only.
+  NameLookup                                    mesh_indices = {};
+  NameLookup                                    node_indices = {};
   absl::flat_hash_map<std::string, std::string> image_files  = {};
+
+  // node indices in topological (parent before child) order, world transforms
+  // are propagated with one linear pass over it
+  std::vector<uint32_t> node_order = {};
+
+private:
+  void deduplicate_meshes(uint32_t thread_count);
+  void build_node_order();
+  void propagate_transforms(uint32_t begin, uint32_t end);
+
+  glm::mat4 model_transform = glm::mat4{ 1.f };
+  SceneBvh  scene_bvh;
+
+  // nodes whose world transform changed since the last refit, refit_all is
+  // set instead when every node moved
+  bool                  refit_all   = false;
+  std::vector<uint32_t> refit_nodes = {};
+  std::vector<uint8_t>  refit_marks = {};
+
+  // node index -> position in node_order, INVALID_INDEX when unreachable
+  std::vector<uint32_t> node_positions = {};
+  // position in node_order -> one past the last position of that subtree
+  std::vector<uint32_t> subtree_ends = {};
+  std::vector<uint32_t> dirty_nodes  = {};
 };
 
 } // namespace pxd::ass
\ No newline at end of file
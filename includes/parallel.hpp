@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pxd::ass {
+
+// 0 selects every hardware thread, the result is never more than the number
+// of tasks so tiny workloads stay on the calling thread
+inline auto
+resolve_thread_count(uint32_t thread_count, size_t task_count) -> uint32_t
+{
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  return static_cast<uint32_t>(
+    std::max<size_t>(1, std::min<size_t>(thread_count, task_count)));
+}
+
+// Calls func(i) for every i in [0, count). Tasks are handed out one by one
+// from a shared counter so uneven task sizes still balance across workers.
+// The first exception thrown by a task is rethrown on the calling thread.
+template<typename F>
+void
+parallel_for(size_t count, uint32_t thread_count, F&& func)
+{
+  const uint32_t worker_count = resolve_thread_count(thread_count, count);
+
+  if (worker_count == 1) {
+    for (size_t i = 0; i < count; ++i) {
+      func(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_task = 0;
+  std::exception_ptr  first_exception;
+  std::mutex          exception_mutex;
+
+  auto worker = [&]() {
+    for (size_t i = next_task++; i < count; i = next_task++) {
+      try {
+        func(i);
+      } catch (...) {
+        std::lock_guard lock(exception_mutex);
+        if (!first_exception) {
+          first_exception = std::current_exception();
+        }
+        next_task = count;
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(worker_count - 1);
+
+    for (uint32_t i = 1; i < worker_count; ++i) {
+      workers.emplace_back(worker);
+    }
+
+    worker();
+  }
+
+  if (first_exception) {
+    std::rethrow_exception(first_exception);
+  }
+}
+
+} // namespace pxd::ass
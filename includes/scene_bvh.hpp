@@ -0,0 +1,91 @@
+#pragma once
+
+#include "culling.hpp"
+#include "types.hpp"
+
+#include <span>
+#include <vector>
+
+namespace pxd::ass {
+
+// one mesh placed by one node
+struct MeshInstance
+{
+  uint32_t node_index;
+  uint32_t mesh_index;
+};
+
+// a leaf when left_child is 0 (the root is never a child), otherwise the
+// children are left_child and left_child + 1. Every node covers the instances
+// [first_instance, first_instance + instance_count) in leaf order.
+struct SceneBvhNode
+{
+  glm::vec3 aabb_min;
+  uint32_t  first_instance;
+  glm::vec3 aabb_max;
+  uint32_t  instance_count;
+  uint32_t  left_child;
+  uint32_t  parent;
+};
+
+constexpr uint32_t SCENE_BVH_LEAF_SIZE = 4;
+
+// Bounding volume hierarchy over the world space bounds of every (node, mesh)
+// instance. The topology is built once, transform changes only refit the
+// boxes of the affected instances and their ancestors. The leaves read the
+// same SoA world bounds the batched culler tests, so every instance is
+// transformed once per change.
+class SceneBvh
+{
+public:
+  // node_positions is INVALID_INDEX for nodes outside the node order. Those
+  // are unreachable from a root, never get a world transform, and their
+  // meshes are left out.
+  void build(const std::vector<MeshNode>& nodes,
+             const std::vector<Mesh>&     meshes,
+             std::span<const uint32_t>    node_positions);
+  void clear();
+
+  // refits every instance, or only the instances of changed_nodes
+  void refit(const std::vector<MeshNode>& nodes,
+             const std::vector<Mesh>&     meshes);
+  void refit(const std::vector<MeshNode>& nodes,
+             const std::vector<Mesh>&     meshes,
+             std::span<const uint32_t>    changed_nodes);
+
+  // appends every instance whose world aabb touches the frustum
+  void query_frustum(const Frustum&             frustum,
+                     std::vector<MeshInstance>& out_instances) const;
+  // replaces out_visible with the indices into get_instances() whose world
+  // sphere and aabb touch the frustum, tested in batches without the tree
+  void cull(const Frustum& frustum, std::vector<uint32_t>& out_visible) const;
+
+  auto empty() const -> bool { return bvh_nodes.empty(); }
+
+  auto get_nodes() const -> std::span<const SceneBvhNode> { return bvh_nodes; }
+  auto get_instances() const -> std::span<const MeshInstance>
+  {
+    return instances;
+  }
+
+private:
+  void update_instance_bounds(const std::vector<MeshNode>& nodes,
+                              const std::vector<Mesh>&     meshes,
+                              uint32_t                     slot);
+
+  std::vector<SceneBvhNode> bvh_nodes = {};
+
+  // instances, their world bounds and their leaves in leaf order
+  std::vector<MeshInstance> instances       = {};
+  InstanceBounds            world_bounds    = {};
+  std::vector<uint32_t>     instance_leaves = {};
+
+  // node index -> range of node_slots holding the leaf order slots of its
+  // instances
+  std::vector<uint32_t> node_slot_offsets = {};
+  std::vector<uint32_t> node_slots        = {};
+
+  std::vector<uint8_t> refit_marks = {};
+};
+
+} // namespace pxd::ass
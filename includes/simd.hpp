@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pxd::ass {
+
+// destination[i] = source[i] + offset, 8 and 16 bit indices are widened to
+// 32 bit on the way
+void
+copy_indices_with_offset(const uint8_t* source,
+                         uint32_t*      destination,
+                         size_t         count,
+                         uint32_t       offset);
+void
+copy_indices_with_offset(const uint16_t* source,
+                         uint32_t*       destination,
+                         size_t          count,
+                         uint32_t        offset);
+void
+copy_indices_with_offset(const uint32_t* source,
+                         uint32_t*       destination,
+                         size_t          count,
+                         uint32_t        offset);
+
+// out = lhs * rhs for column-major 4x4 float matrices, out may alias either
+// operand
+void
+multiply_mat4(const float* lhs, const float* rhs, float* out);
+
+// per component min and max of count xyz points that are stride floats
+// apart, count has to be at least 1. Stride 3 (packed) and 4 (aligned
+// glm::vec3) take the AVX2 path, the padding float is never read into the
+// result.
+void
+min_max_points(const float* points,
+               size_t       count,
+               size_t       stride,
+               float*       out_min,
+               float*       out_max);
+
+// world space bounds in SoA layout, every array holds at least count floats
+// rounded up to a multiple of 8
+struct CullBounds
+{
+  const float* sphere_x;
+  const float* sphere_y;
+  const float* sphere_z;
+  const float* sphere_radius;
+  const float* aabb_center_x;
+  const float* aabb_center_y;
+  const float* aabb_center_z;
+  const float* aabb_extent_x;
+  const float* aabb_extent_y;
+  const float* aabb_extent_z;
+};
+
+// Tests count spheres and aabbs against 6 planes given as 24 floats
+// (nx, ny, nz, d), 8 per iteration. An element is visible when neither its
+// sphere nor its aabb is fully behind a plane. Visible indices are written
+// to out_indices in ascending order and their number is returned.
+auto
+frustum_cull(const float*      planes,
+             const CullBounds& bounds,
+             size_t            count,
+             uint32_t*         out_indices) -> size_t;
+
+} // namespace pxd::ass
@@ -6,18 +6,49 @@
 #include "../third-party/glm/glm/mat4x4.hpp"
 #include "../third-party/glm/glm/vec4.hpp"
 
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
 namespace pxd::ass {
+
+// marks a missing parent, child or mesh link
+constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
 struct Bounds
 {
-  glm::vec3 aabb_min;
-  float     sphere_radius;
-  glm::vec3 aabb_max;
-  float     _pad;
+  glm::vec3 aabb_min      = glm::vec3{ 0.f };
+  float     sphere_radius = 0.f;
+  glm::vec3 aabb_max      = glm::vec3{ 0.f };
+  float     _pad          = 0.f;
+  glm::vec3 sphere_center = glm::vec3{ 0.f };
+  float     _pad1         = 0.f;
+};
+
+// A primitive of a mesh. Its triangles are index_count indices from
+// index_offset in Mesh::indices, and they only reference vertices in
+// [vertex_offset, vertex_offset + vertex_count) of the vertex streams.
+struct SubMesh
+{
+  uint32_t index_offset   = 0;
+  uint32_t index_count    = 0;
+  uint32_t vertex_offset  = 0;
+  uint32_t vertex_count   = 0;
+  uint32_t material_index = INVALID_INDEX;
+  Bounds   bounds;
 };
 
+// Aabb of positions through the SIMD min/max kernel, large inputs are split
+// over thread_count workers. tight_sphere keeps the smaller of Ritter's
+// sphere and the aabb sphere, otherwise the aabb sphere is used.
+Bounds
+calculate_bounds(std::span<const glm::vec3> positions,
+                 uint32_t                   thread_count = 1,
+                 bool                       tight_sphere = false);
+
 struct Vertex
 {
   glm::vec3 pos;
@@ -25,6 +56,56 @@ struct Vertex
   glm::vec2 uv;
 };
 
+enum class POSITION_FORMAT : uint8_t
+{
+  FLOAT32,
+  // 3 x half relative to the bounds center, padded to 8 bytes
+  HALF,
+  // 3 x unorm16 over the aabb, padded to 8 bytes
+  UNORM16
+};
+
+enum class NORMAL_FORMAT : uint8_t
+{
+  FLOAT32,
+  // 2 x snorm16 octahedral encoding
+  OCTAHEDRAL
+};
+
+enum class UV_FORMAT : uint8_t
+{
+  FLOAT32,
+  HALF,
+  // 2 x unorm16 over the uv range of the mesh
+  UNORM16
+};
+
+struct VertexFormat
+{
+  POSITION_FORMAT position = POSITION_FORMAT::HALF;
+  NORMAL_FORMAT   normal   = NORMAL_FORMAT::OCTAHEDRAL;
+  UV_FORMAT       uv       = UV_FORMAT::HALF;
+};
+
+// Interleaved vertices ready for upload. A stored position or uv decodes as
+// origin + value * scale, where value is the float, half or unorm16 / 65535
+// component as stored.
+struct PackedVertices
+{
+  VertexFormat format;
+  uint32_t     stride          = 0;
+  uint32_t     position_offset = 0;
+  uint32_t     normal_offset   = 0;
+  uint32_t     uv_offset       = 0;
+
+  glm::vec3 position_origin{ 0.f };
+  glm::vec3 position_scale{ 1.f };
+  glm::vec2 uv_origin{ 0.f };
+  glm::vec2 uv_scale{ 1.f };
+
+  std::vector<uint8_t> data;
+};
+
 struct Triangle
 {
   uint32_t i_0;
@@ -53,6 +134,82 @@ struct Quad
   }
 };
 
+// One step of a LOD chain. Every submesh is simplified on its own and stops
+// at triangle_ratio of its full index count or when the error, relative to
+// the submesh extent, would exceed target_error, whichever comes first.
+struct LodTarget
+{
+  float triangle_ratio = 0.5f;
+  float target_error   = 0.01f;
+};
+
+// simplified index buffer over the vertex streams of its mesh, submesh s
+// covers [submesh_offsets[s], submesh_offsets[s + 1]) of indices. error is
+// the largest accumulated relative error of a submesh chain up to this level.
+struct MeshLod
+{
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> submesh_offsets;
+  float                 error = 0.f;
+};
+
+constexpr size_t MESHLET_MAX_VERTICES  = 64;
+constexpr size_t MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of triangles. vertex_offset indexes Mesh::meshlet_vertices and
+// triangle_offset indexes Mesh::meshlet_triangles, which holds 3 local
+// vertex indices per triangle. The sphere and normal cone are used for
+// cluster culling, a meshlet is backfacing when
+// dot(normalize(cone_apex - eye), cone_axis) >= cone_cutoff.
+struct Meshlet
+{
+  uint32_t vertex_offset;
+  uint32_t triangle_offset;
+  uint32_t vertex_count;
+  uint32_t triangle_count;
+
+  glm::vec3 center;
+  float     radius;
+  glm::vec3 cone_apex;
+  glm::vec3 cone_axis;
+  float     cone_cutoff;
+};
+
+// meshoptimizer encoded copies of a mesh's indices and vertex streams
+struct EncodedGeometry
+{
+  size_t index_count  = 0;
+  size_t vertex_count = 0;
+
+  std::vector<uint8_t> indices;
+  std::vector<uint8_t> positions;
+  std::vector<uint8_t> normals;
+  std::vector<uint8_t> uvs;
+};
+
+// Edge adjacency of a triangle list. Half-edge h = 3 * triangle + corner runs
+// from that corner to the next one. twins[h] is the half-edge of the
+// neighbouring triangle on the same edge, or INVALID_INDEX on a boundary.
+// Winding is ignored when matching edges, and an edge shared by more than two
+// triangles only pairs the first two.
+struct MeshConnectivity
+{
+  std::vector<uint32_t> twins;
+
+  static uint32_t get_triangle(uint32_t half_edge) { return half_edge / 3; }
+  static uint32_t get_next(uint32_t half_edge)
+  {
+    return half_edge - half_edge % 3 + (half_edge + 1) % 3;
+  }
+
+  bool is_boundary(uint32_t half_edge) const
+  {
+    return twins[half_edge] == INVALID_INDEX;
+  }
+};
+
+class MeshBvh;
+
 struct Mesh
 {
   std::string           name;
@@ -63,34 +220,104 @@ struct Mesh
   std::vector<glm::vec3> normals;
   std::vector<glm::vec2> uvs;
 
+  // primitive ranges, bounds is the union of their bounds
+  std::vector<SubMesh> submeshes;
+
   std::vector<Triangle> triangles;
   std::vector<Quad>     quads;
 
+  // simplified levels, coarsest last, indices is the full detail level
+  std::vector<MeshLod> lods;
+
+  // submesh s owns meshlets [meshlet_offsets[s], meshlet_offsets[s + 1])
+  std::vector<Meshlet>  meshlets;
+  std::vector<uint32_t> meshlet_vertices;
+  std::vector<uint8_t>  meshlet_triangles;
+  std::vector<uint32_t> meshlet_offsets;
+
+  // bounds of every submesh and of the whole mesh
+  void calculate_bounds(uint32_t thread_count = 1, bool tight_sphere = false);
+
   std::vector<Vertex> get_AoS();
   void                from_AoS(std::vector<Vertex>& vertices);
   void                calculate_triangles();
   void                calculate_quads();
+
+  // built from indices on first use and cached until invalidated, anything
+  // that rewrites indices has to call invalidate_connectivity. from_AoS,
+  // compress and decompress already do.
+  const MeshConnectivity& get_connectivity(uint32_t thread_count = 1);
+  const MeshConnectivity& get_cached_connectivity() const
+  {
+    return connectivity;
+  }
+  bool is_connectivity_valid() const { return connectivity_valid; }
+  void invalidate_connectivity();
+  void find_boundary_edges(std::vector<uint32_t>& out_half_edges);
+
+  // triangle bvh for ray casts and closest point queries, only built on
+  // request and shared between copies of the mesh. Anything that changes
+  // positions or indices has to reset it.
+  std::shared_ptr<const MeshBvh> bvh;
+
+  void build_bvh(uint32_t thread_count = 1);
+
+  PackedVertices pack_vertices(const VertexFormat& format = {}) const;
+
+  // Builds lods from targets in order, each level simplifies the previous
+  // one submesh at a time. The chain ends early once a level cannot remove
+  // any triangles from any submesh.
+  void generate_lods(std::span<const LodTarget> targets);
+
+  // splits every submesh's indices into meshlets and computes their culling
+  // bounds, max_triangles has to be a multiple of 4
+  void build_meshlets(size_t max_vertices  = MESHLET_MAX_VERTICES,
+                      size_t max_triangles = MESHLET_MAX_TRIANGLES,
+                      float  cone_weight   = 0.25f);
+
+  // compress encodes indices, positions, normals and uvs into encoded and
+  // releases them along with the triangles, quads, connectivity and bvh built
+  // from them. The vertex streams come back bit exact, but meshopt's index
+  // codec may rotate the corners of a triangle, so the restored indices keep
+  // triangle order and winding but are not identical to the originals.
+  // decompress therefore also drops the lods and meshlets built before
+  // compress, rebuild them from the restored indices when needed. The
+  // decode_* accessors read a single stream out of encoded without touching
+  // the mesh.
+  EncodedGeometry encoded;
+
+  bool is_compressed() const;
+  bool compress();
+  bool decompress();
+  bool decode_indices(std::vector<uint32_t>& out_indices) const;
+  bool decode_positions(std::vector<glm::vec3>& out_positions) const;
+  bool decode_normals(std::vector<glm::vec3>& out_normals) const;
+  bool decode_uvs(std::vector<glm::vec2>& out_uvs) const;
+
+private:
+  MeshConnectivity connectivity       = {};
+  bool             connectivity_valid = false;
 };
 
+// calculate_bounds for every mesh, small meshes run side by side and large
+// ones get every worker in turn
+void
+calculate_mesh_bounds(std::span<Mesh> meshes,
+                      uint32_t        thread_count = 1,
+                      bool            tight_sphere = false);
+
+// parent, children and meshes are indices into Model::nodes and Model::meshes
 struct MeshNode
 {
   std::string name;
 
-  MeshNode*              parent = nullptr;
-  std::vector<MeshNode*> children;
-
-  std::vector<Mesh*> meshes;
+  uint32_t              parent = INVALID_INDEX;
+  std::vector<uint32_t> children;
 
-  glm::mat4 local_transform;
-  glm::mat4 world_transform;
+  std::vector<uint32_t> meshes;
 
-  void reassign_transforms(const glm::mat4& parent_matrix)
-  {
-    world_transform = parent_matrix * local_transform;
-    for (auto&& c : children) {
-      c->reassign_transforms(world_transform);
-    }
-  }
+  glm::mat4 local_transform = glm::mat4{ 1.f };
+  glm::mat4 world_transform = glm::mat4{ 1.f };
 };
 
 }
\ No newline at end of file
@@ -13,9 +13,11 @@ main()
 
   // model.optimize_meshes();
 
-  std::vector<pxd::ass::Mesh> meshes = model.get_meshes();
+  std::span<pxd::ass::Mesh> meshes = model.get_meshes();
 
-  std::cout << model.parent_nodes[0]->meshes[0]->name;
+  const pxd::ass::MeshNode& root = model.nodes[model.parent_nodes[0]];
+
+  std::cout << model.meshes[root.meshes[0]].name;
 
   model.destroy();
 
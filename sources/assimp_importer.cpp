@@ -12,6 +12,8 @@
 #include "vec2.hpp"
 #include "vec3.hpp"
 
+#include "parallel.hpp"
+
 namespace pxd::ass {
 
 template<typename T = aiVector3D>
@@ -51,10 +53,11 @@ ai2glm_mat4x4(aiMatrix4x4& ai) -> glm::mat4
 }
 
 bool
-AssimpImport::init(std::string_view&                           filepath,
-                   absl::flat_hash_map<std::string, Mesh>&     meshes,
-                   absl::flat_hash_map<std::string, MeshNode>& nodes,
-                   std::vector<MeshNode*>&                     parent_nodes)
+AssimpImport::init(std::string_view&      filepath,
+                   const ImportOptions&   options,
+                   std::vector<Mesh>&     meshes,
+                   std::vector<MeshNode>& nodes,
+                   std::vector<uint32_t>& parent_nodes)
 {
 
   Assimp::Importer importer;
@@ -66,7 +69,7 @@ AssimpImport::init(std::string_view&                           filepath,
     aiProcess_Triangulate | aiProcess_GenSmoothNormals |
     aiProcess_SplitLargeMeshes | aiProcess_FixInfacingNormals |
     aiProcess_FindDegenerates | aiProcess_GenUVCoords |
-    aiProcess_OptimizeMeshes | aiProcess_FlipUVs | aiProcess_GenBoundingBoxes;
+    aiProcess_OptimizeMeshes | aiProcess_FlipUVs;
 
 #if defined(PXD_ASS_SPLIT_LARGE_MESHES)
   read_flags |= aiProcess_SplitLargeMeshes
@@ -82,43 +85,66 @@ AssimpImport::init(std::string_view&                           filepath,
     return false;
   }
 
-  process_node(scene->mRootNode, scene, meshes, nodes);
+  // meshes are converted up front so the node pass below only has to link
+  // them, this is where most of the import time goes for large scenes
+  meshes.resize(scene->mNumMeshes);
 
-  assign_children(scene->mRootNode, nodes);
-  add_parents(nodes, parent_nodes);
+  parallel_for(scene->mNumMeshes, options.thread_count, [&](size_t i) {
+    meshes[i] = process_mesh(scene->mMeshes[i], scene);
+  });
+
+  calculate_mesh_bounds(
+    meshes, options.thread_count, options.tight_bounding_spheres);
+
+  process_hierarchy(scene->mRootNode, nodes, parent_nodes);
 
   return true;
 }
 
 void
-AssimpImport::process_node(aiNode*                                     node,
-                           const aiScene*                              scene,
-                           absl::flat_hash_map<std::string, Mesh>&     meshes,
-                           absl::flat_hash_map<std::string, MeshNode>& nodes)
+AssimpImport::process_hierarchy(aiNode*                root,
+                                std::vector<MeshNode>& nodes,
+                                std::vector<uint32_t>& parent_nodes)
 {
-  aiMesh*     mesh = nullptr;
-  std::string mesh_name;
+  // the hierarchy is walked once in pre-order with an explicit stack, every
+  // visited node carries the index of its parent so nodes are linked as they
+  // are added
+  std::vector<std::pair<aiNode*, uint32_t>> node_stack = { { root,
+                                                             INVALID_INDEX } };
 
-  MeshNode mesh_node;
-  mesh_node.name = node->mName.C_Str();
-  mesh_node.meshes.reserve(node->mNumMeshes);
+  while (!node_stack.empty()) {
+    auto [node, parent_index] = node_stack.back();
+    node_stack.pop_back();
 
-  for (int i = 0; i < node->mNumMeshes; ++i) {
-    mesh      = scene->mMeshes[node->mMeshes[i]];
-    mesh_name = mesh->mName.C_Str();
+    const uint32_t node_index = static_cast<uint32_t>(nodes.size());
 
-    Mesh mesh_struct;
-    meshes.insert({ mesh_name, process_mesh(mesh, scene) });
+    process_node(node, parent_index, nodes);
 
-    mesh_node.meshes.push_back(&meshes[mesh_name]);
+    for (unsigned int i = node->mNumChildren; i > 0; --i) {
+      node_stack.push_back({ node->mChildren[i - 1], node_index });
+    }
   }
 
-  mesh_node.local_transform = ai2glm_mat4x4(node->mTransformation);
+  add_parents(nodes, parent_nodes);
+}
+
+void
+AssimpImport::process_node(aiNode*                node,
+                           uint32_t               parent_index,
+                           std::vector<MeshNode>& nodes)
+{
+  const uint32_t node_index = static_cast<uint32_t>(nodes.size());
+
+  MeshNode& mesh_node = nodes.emplace_back();
+  mesh_node.name      = node->mName.C_Str();
+  mesh_node.parent    = parent_index;
+  mesh_node.meshes.assign(node->mMeshes, node->mMeshes + node->mNumMeshes);
+  mesh_node.children.reserve(node->mNumChildren);
 
-  nodes.insert({ mesh_node.name, mesh_node });
+  mesh_node.local_transform = ai2glm_mat4x4(node->mTransformation);
 
-  for (int i = 0; i < node->mNumChildren; ++i) {
-    process_node(node->mChildren[i], scene, meshes, nodes);
+  if (parent_index != INVALID_INDEX) {
+    nodes[parent_index].children.push_back(node_index);
   }
 }
 
@@ -129,11 +155,7 @@ AssimpImport::process_mesh(aiMesh* mesh, const aiScene* scene) -> Mesh
 
   Mesh temp_mesh;
 
-  temp_mesh.name            = mesh->mName.C_Str();
-  temp_mesh.bounds.aabb_min = ai2glm_vec3(mesh->mAABB.mMin);
-  temp_mesh.bounds.aabb_max = ai2glm_vec3(mesh->mAABB.mMax);
-  temp_mesh.bounds.sphere_radius =
-    glm::length(temp_mesh.bounds.aabb_max - temp_mesh.bounds.aabb_min) / 2.f;
+  temp_mesh.name = mesh->mName.C_Str();
 
   temp_mesh.positions.resize(size);
   temp_mesh.normals.resize(size);
@@ -165,42 +187,25 @@ AssimpImport::process_mesh(aiMesh* mesh, const aiScene* scene) -> Mesh
     }
   }
 
-  return temp_mesh;
-}
+  // an aiMesh already holds a single material
+  SubMesh& submesh       = temp_mesh.submeshes.emplace_back();
+  submesh.index_count    = static_cast<uint32_t>(temp_mesh.indices.size());
+  submesh.vertex_count   = size;
+  submesh.material_index = mesh->mMaterialIndex;
 
-void
-AssimpImport::assign_children(aiNode* root_node,
-                              absl::flat_hash_map<std::string, MeshNode>& nodes)
-{
-  for (auto&& [node_name, node] : nodes) {
-    aiNode* parent_node = root_node->FindNode(node.name.c_str());
-
-    if (parent_node == nullptr) {
-      continue;
-    }
-
-    nodes[node_name].children.reserve(parent_node->mNumChildren);
-
-    for (int i = 0; i < parent_node->mNumChildren; ++i) {
-      std::string child_name = parent_node->mChildren[i]->mName.C_Str();
-
-      nodes[child_name].parent = &nodes[node_name];
-      nodes[node_name].children.push_back(&nodes[child_name]);
-    }
-  }
+  return temp_mesh;
 }
 
 void
-AssimpImport::add_parents(absl::flat_hash_map<std::string, MeshNode>& nodes,
-                          std::vector<MeshNode*>& parent_nodes)
+AssimpImport::add_parents(std::vector<MeshNode>& nodes,
+                          std::vector<uint32_t>& parent_nodes)
 {
-  for (auto&& [node_name, node] : nodes) {
-    if (node.parent != nullptr) {
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    if (nodes[i].parent != INVALID_INDEX) {
       continue;
     }
 
-    node.reassign_transforms(glm::mat4{ 1.f });
-    parent_nodes.push_back(&node);
+    parent_nodes.push_back(i);
   }
 }
 }
\ No newline at end of file
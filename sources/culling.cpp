@@ -0,0 +1,153 @@
+#include "culling.hpp"
+
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace pxd::ass {
+
+auto
+Frustum::from_matrix(const glm::mat4& view_projection) -> Frustum
+{
+  const glm::mat4& m = view_projection;
+
+  auto row = [&](int i) {
+    return glm::vec4{ m[0][i], m[1][i], m[2][i], m[3][i] };
+  };
+
+  const glm::vec4 r0 = row(0);
+  const glm::vec4 r1 = row(1);
+  const glm::vec4 r2 = row(2);
+  const glm::vec4 r3 = row(3);
+
+  Frustum frustum;
+  frustum.planes[0] = r3 + r0;
+  frustum.planes[1] = r3 - r0;
+  frustum.planes[2] = r3 + r1;
+  frustum.planes[3] = r3 - r1;
+#if defined(GLM_FORCE_DEPTH_ZERO_TO_ONE)
+  frustum.planes[4] = r2;
+#else
+  frustum.planes[4] = r3 + r2;
+#endif
+  frustum.planes[5] = r3 - r2;
+
+  for (glm::vec4& plane : frustum.planes) {
+    const float length =
+      std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+    if (length > 0.f) {
+      plane = plane * (1.f / length);
+    }
+  }
+
+  return frustum;
+}
+
+void
+InstanceBounds::resize(size_t new_count)
+{
+  count = new_count;
+
+  const size_t padded_count = (count + 7) & ~size_t(7);
+
+  for (std::vector<float>* stream : { &sphere_x,
+                                      &sphere_y,
+                                      &sphere_z,
+                                      &sphere_radius,
+                                      &aabb_center_x,
+                                      &aabb_center_y,
+                                      &aabb_center_z,
+                                      &aabb_extent_x,
+                                      &aabb_extent_y,
+                                      &aabb_extent_z }) {
+    stream->assign(padded_count, 0.f);
+  }
+}
+
+void
+InstanceBounds::clear()
+{
+  resize(0);
+}
+
+void
+InstanceBounds::update(size_t           slot,
+                       const glm::mat4& world_transform,
+                       const Bounds&    local_bounds)
+{
+  const glm::mat4& m = world_transform;
+
+  const glm::vec3& aabb_min      = local_bounds.aabb_min;
+  const glm::vec3& aabb_max      = local_bounds.aabb_max;
+  const glm::vec3& sphere_center = local_bounds.sphere_center;
+  const glm::vec3  center        = (aabb_min + aabb_max) * 0.5f;
+  const glm::vec3  extent        = (aabb_max - aabb_min) * 0.5f;
+
+  float world_sphere[3];
+  float world_center[3];
+  float world_extent[3];
+
+  // the extents are carried through the absolute value of the linear part so
+  // the aabb stays tight under rotation
+  for (int r = 0; r < 3; r++) {
+    world_sphere[r] = m[0][r] * sphere_center.x + m[1][r] * sphere_center.y +
+                      m[2][r] * sphere_center.z + m[3][r];
+    world_center[r] = m[0][r] * center.x + m[1][r] * center.y +
+                      m[2][r] * center.z + m[3][r];
+    world_extent[r] = std::abs(m[0][r]) * extent.x +
+                      std::abs(m[1][r]) * extent.y +
+                      std::abs(m[2][r]) * extent.z;
+  }
+
+  float max_scale2 = 0.f;
+
+  for (int c = 0; c < 3; c++) {
+    max_scale2 = std::max(
+      max_scale2, m[c][0] * m[c][0] + m[c][1] * m[c][1] + m[c][2] * m[c][2]);
+  }
+
+  sphere_x[slot]      = world_sphere[0];
+  sphere_y[slot]      = world_sphere[1];
+  sphere_z[slot]      = world_sphere[2];
+  sphere_radius[slot] = local_bounds.sphere_radius * std::sqrt(max_scale2);
+  aabb_center_x[slot] = world_center[0];
+  aabb_center_y[slot] = world_center[1];
+  aabb_center_z[slot] = world_center[2];
+  aabb_extent_x[slot] = world_extent[0];
+  aabb_extent_y[slot] = world_extent[1];
+  aabb_extent_z[slot] = world_extent[2];
+}
+
+void
+InstanceBounds::cull(const Frustum&         frustum,
+                     std::vector<uint32_t>& out_visible) const
+{
+  float planes[24];
+
+  for (int p = 0; p < 6; p++) {
+    planes[p * 4]     = frustum.planes[p].x;
+    planes[p * 4 + 1] = frustum.planes[p].y;
+    planes[p * 4 + 2] = frustum.planes[p].z;
+    planes[p * 4 + 3] = frustum.planes[p].w;
+  }
+
+  const CullBounds bounds = {
+    .sphere_x      = sphere_x.data(),
+    .sphere_y      = sphere_y.data(),
+    .sphere_z      = sphere_z.data(),
+    .sphere_radius = sphere_radius.data(),
+    .aabb_center_x = aabb_center_x.data(),
+    .aabb_center_y = aabb_center_y.data(),
+    .aabb_center_z = aabb_center_z.data(),
+    .aabb_extent_x = aabb_extent_x.data(),
+    .aabb_extent_y = aabb_extent_y.data(),
+    .aabb_extent_z = aabb_extent_z.data(),
+  };
+
+  out_visible.resize(count);
+  out_visible.resize(frustum_cull(planes, bounds, count, out_visible.data()));
+}
+
+} // namespace pxd::ass
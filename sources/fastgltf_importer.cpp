@@ -10,12 +10,330 @@
 
 #include "gtx/quaternion.hpp"
 
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <span>
+
 namespace pxd::ass {
+
+struct GltfPrimitiveRange
+{
+  size_t               mesh_index;
+  size_t               submesh_index;
+  fastgltf::Primitive* primitive;
+  size_t               initial_vertex;
+  size_t               initial_index;
+};
+
+// bytes of a buffer that are already in memory, empty for sources that are
+// not loaded
+auto
+get_buffer_bytes(const fastgltf::Buffer& buffer) -> std::span<const std::byte>
+{
+  return std::visit(
+    fastgltf::visitor{
+      [](const auto&) -> std::span<const std::byte> { return {}; },
+      [](const fastgltf::sources::Vector& vec) -> std::span<const std::byte> {
+        return { reinterpret_cast<const std::byte*>(vec.bytes.data()),
+                 vec.bytes.size() };
+      },
+      [](const fastgltf::sources::ByteView& view)
+        -> std::span<const std::byte> {
+        return { view.bytes.data(), view.bytes.size() };
+      } },
+    buffer.data);
+}
+
+// True when count elements of element_size bytes, stride bytes apart from
+// byte_offset into a buffer view, lie inside that view and the view lies
+// inside the loaded bytes of its buffer. A stride of 0 takes the view's
+// byteStride, or packs the elements when it has none. Nothing is validated on
+// parse, so a malformed file would otherwise be read past its buffers.
+auto
+is_view_range_in_bounds(const fastgltf::Asset& gltf,
+                        size_t                 view_index,
+                        size_t                 byte_offset,
+                        size_t                 element_size,
+                        size_t                 stride,
+                        size_t                 count) -> bool
+{
+  if (view_index >= gltf.bufferViews.size() || element_size == 0) {
+    return false;
+  }
+
+  const fastgltf::BufferView& view = gltf.bufferViews[view_index];
+
+  if (view.bufferIndex >= gltf.buffers.size()) {
+    return false;
+  }
+
+  if (stride == 0) {
+    stride = view.byteStride.has_value() ? *view.byteStride : element_size;
+  }
+
+  // written as differences so a huge count or offset cannot overflow
+  if (count != 0) {
+    if (stride == 0 || byte_offset > view.byteLength ||
+        element_size > view.byteLength - byte_offset) {
+      return false;
+    }
+
+    const size_t trailing_bytes = view.byteLength - byte_offset - element_size;
+
+    if (count - 1 > trailing_bytes / stride) {
+      return false;
+    }
+  }
+
+  const fastgltf::Buffer&          buffer = gltf.buffers[view.bufferIndex];
+  const std::span<const std::byte> bytes  = get_buffer_bytes(buffer);
+  const size_t buffer_size = bytes.empty() ? buffer.byteLength : bytes.size();
+
+  return view.byteOffset <= buffer_size &&
+         view.byteLength <= buffer_size - view.byteOffset;
+}
+
+// True when every element of accessor, and the indices and values of its
+// sparse substitution, lie inside their buffer views. An accessor without a
+// buffer view reads zeros for its dense part.
+auto
+is_accessor_in_bounds(const fastgltf::Asset&    gltf,
+                      const fastgltf::Accessor& accessor) -> bool
+{
+  const size_t element_size =
+    fastgltf::getElementByteSize(accessor.type, accessor.componentType);
+
+  if (element_size == 0) {
+    return false;
+  }
+
+  if (accessor.bufferViewIndex.has_value() &&
+      !is_view_range_in_bounds(gltf,
+                               *accessor.bufferViewIndex,
+                               accessor.byteOffset,
+                               element_size,
+                               0,
+                               accessor.count)) {
+    return false;
+  }
+
+  if (!accessor.sparse.has_value()) {
+    return true;
+  }
+
+  // sparse indices and values are always tightly packed
+  const fastgltf::SparseAccessor& sparse = *accessor.sparse;
+  const size_t                    index_size =
+    fastgltf::getElementByteSize(fastgltf::AccessorType::Scalar,
+                                 sparse.indexComponentType);
+
+  return sparse.count <= accessor.count &&
+         is_view_range_in_bounds(gltf,
+                                 sparse.indicesBufferView,
+                                 sparse.indicesByteOffset,
+                                 index_size,
+                                 index_size,
+                                 sparse.count) &&
+         is_view_range_in_bounds(gltf,
+                                 sparse.valuesBufferView,
+                                 sparse.valuesByteOffset,
+                                 element_size,
+                                 element_size,
+                                 sparse.count);
+}
+
+// Returns the first element of an accessor whose elements sit back to back in
+// an already loaded buffer, or nullptr when the accessor is sparse, normalized,
+// interleaved, out of bounds or of another type and has to go through
+// iterateAccessor
+auto
+get_packed_accessor_data(fastgltf::Asset&        gltf,
+                         fastgltf::Accessor&     accessor,
+                         fastgltf::AccessorType  type,
+                         fastgltf::ComponentType component_type)
+  -> const std::byte*
+{
+  if (accessor.type != type || accessor.componentType != component_type ||
+      accessor.normalized || accessor.sparse.has_value() ||
+      !accessor.bufferViewIndex.has_value() ||
+      !is_accessor_in_bounds(gltf, accessor)) {
+    return nullptr;
+  }
+
+  fastgltf::BufferView& view = gltf.bufferViews[*accessor.bufferViewIndex];
+
+  if (view.byteStride.has_value() &&
+      *view.byteStride != fastgltf::getElementByteSize(type, component_type)) {
+    return nullptr;
+  }
+
+  const std::span<const std::byte> bytes =
+    get_buffer_bytes(gltf.buffers[view.bufferIndex]);
+
+  if (bytes.empty()) {
+    return nullptr;
+  }
+
+  return bytes.data() + view.byteOffset + accessor.byteOffset;
+}
+
+// A primitive is only decoded when every accessor it names exists and is in
+// bounds, it has positions, and every other attribute has one element per
+// position. Indices are optional, a primitive without them is drawn in
+// vertex order.
+auto
+is_primitive_valid(const fastgltf::Asset& gltf, fastgltf::Primitive& p) -> bool
+{
+  auto positions = p.findAttribute("POSITION");
+
+  if (positions == p.attributes.end() ||
+      positions->second >= gltf.accessors.size()) {
+    return false;
+  }
+
+  const size_t vertex_count = gltf.accessors[positions->second].count;
+
+  for (const auto& [name, accessor_index] : p.attributes) {
+    if (accessor_index >= gltf.accessors.size()) {
+      return false;
+    }
+
+    const fastgltf::Accessor& accessor = gltf.accessors[accessor_index];
+
+    if ((name == "POSITION" || name == "NORMAL" || name == "TEXCOORD_0") &&
+        (accessor.count != vertex_count ||
+         !is_accessor_in_bounds(gltf, accessor))) {
+      return false;
+    }
+  }
+
+  return !p.indicesAccessor.has_value() ||
+         (*p.indicesAccessor < gltf.accessors.size() &&
+          is_accessor_in_bounds(gltf, gltf.accessors[*p.indicesAccessor]));
+}
+
+// true when every decoded index of a primitive points into its own vertices
+auto
+are_indices_in_range(const Mesh& mesh, const SubMesh& submesh) -> bool
+{
+  const uint32_t first_vertex = submesh.vertex_offset;
+  const uint32_t last_vertex  = first_vertex + submesh.vertex_count;
+
+  for (uint32_t i = 0; i < submesh.index_count; i++) {
+    const uint32_t index = mesh.indices[submesh.index_offset + i];
+
+    if (index < first_vertex || index >= last_vertex) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 auto
-FastGltfImport::init(std::string_view&                           filepath,
-                     absl::flat_hash_map<std::string, Mesh>&     meshes,
-                     absl::flat_hash_map<std::string, MeshNode>& nodes,
-                     std::vector<MeshNode*>& parent_nodes) -> bool
+map_gltf_file(const std::filesystem::path& path,
+              fastgltf::GltfDataBuffer&    data,
+              std::vector<MappedFile>&     mapped_files) -> bool
+{
+  const size_t padding = fastgltf::getGltfBufferPadding();
+  MappedFile   file;
+
+  if (!file.open(path, padding) ||
+      !data.fromByteView(file.data(), file.size(), file.size() + padding)) {
+    return false;
+  }
+
+  file.advise_sequential();
+  mapped_files.push_back(std::move(file));
+
+  return true;
+}
+
+// Points every buffer that references an external file at a mapping of that
+// file. A buffer whose file cannot be mapped is read into memory instead.
+auto
+map_external_buffers(fastgltf::Asset&             gltf,
+                     const std::filesystem::path& directory,
+                     std::vector<MappedFile>&     mapped_files) -> bool
+{
+  for (fastgltf::Buffer& buffer : gltf.buffers) {
+    auto* uri = std::get_if<fastgltf::sources::URI>(&buffer.data);
+
+    if (uri == nullptr) {
+      continue;
+    }
+
+    if (!uri->uri.isLocalPath()) {
+      return false;
+    }
+
+    const std::filesystem::path buffer_path = directory / uri->uri.fspath();
+    const size_t                offset      = uri->fileByteOffset;
+    const fastgltf::MimeType    mime_type   = uri->mimeType;
+
+    MappedFile file;
+
+    if (file.open(buffer_path) && offset + buffer.byteLength <= file.size()) {
+      file.advise_sequential();
+
+      fastgltf::sources::ByteView view;
+      view.bytes    = fastgltf::span<const std::byte>(
+        reinterpret_cast<const std::byte*>(file.data()) + offset,
+        buffer.byteLength);
+      view.mimeType = mime_type;
+
+      buffer.data = view;
+      mapped_files.push_back(std::move(file));
+      continue;
+    }
+
+    std::ifstream stream(buffer_path, std::ios::binary);
+
+    fastgltf::sources::Vector vec;
+    vec.bytes.resize(buffer.byteLength);
+    vec.mimeType = mime_type;
+
+    stream.seekg(static_cast<std::streamoff>(offset));
+    stream.read(reinterpret_cast<char*>(vec.bytes.data()),
+                static_cast<std::streamsize>(buffer.byteLength));
+
+    if (!stream) {
+      return false;
+    }
+
+    buffer.data = std::move(vec);
+  }
+
+  return true;
+}
+
+template<typename T, size_t ComponentCount>
+void
+copy_packed_floats(const std::byte* source, T* destination, size_t count)
+{
+  constexpr size_t element_size = ComponentCount * sizeof(float);
+
+  if constexpr (sizeof(T) == element_size) {
+    std::memcpy(destination, source, count * element_size);
+  } else {
+    // aligned glm types carry padding so the copy has to go element-wise
+    for (size_t i = 0; i < count; i++) {
+      std::memcpy(&destination[i], source + i * element_size, element_size);
+    }
+  }
+}
+
+auto
+FastGltfImport::init(std::string_view&      filepath,
+                     const ImportOptions&   options,
+                     std::vector<Mesh>&     meshes,
+                     std::vector<MeshNode>& nodes,
+                     std::vector<uint32_t>& parent_nodes) -> bool
 {
   fastgltf::Parser parser(
     fastgltf::Extensions::MSFT_texture_dds |
@@ -30,18 +348,28 @@ FastGltfImport::init(std::string_view&                           filepath,
     fastgltf::Extensions::KHR_materials_sheen |
     fastgltf::Extensions::KHR_materials_specular);
 
-  constexpr auto gltf_options = fastgltf::Options::DontRequireValidAssetMember |
-                                fastgltf::Options::AllowDouble |
-                                fastgltf::Options::LoadExternalBuffers;
+  // with memory mapping the external buffers are mapped after parsing instead
+  // of being read into heap memory by fastgltf
+  const auto gltf_options =
+    fastgltf::Options::DontRequireValidAssetMember |
+    fastgltf::Options::AllowDouble |
+    (options.memory_map ? fastgltf::Options::None
+                        : fastgltf::Options::LoadExternalBuffers);
 
   /////////////////////////////////////////////////////////////////////////////////
   // SCENE LOADING
 
+  // every buffer view handed to fastgltf points into these, they have to
+  // outlive the mesh loading below
+  std::vector<MappedFile> mapped_files;
+
   fastgltf::GltfDataBuffer data;
-  data.loadFromFile(filepath);
+  fastgltf::Asset          gltf;
+  std::filesystem::path    path = filepath;
 
-  fastgltf::Asset       gltf;
-  std::filesystem::path path = filepath;
+  if (!options.memory_map || !map_gltf_file(path, data, mapped_files)) {
+    data.loadFromFile(filepath);
+  }
 
   fastgltf::GltfType type = fastgltf::determineGltfFileType(&data);
 
@@ -54,53 +382,138 @@ FastGltfImport::init(std::string_view&                           filepath,
 
   gltf = std::move(load.get());
 
+  if (options.memory_map &&
+      !map_external_buffers(gltf, path.parent_path(), mapped_files)) {
+    PXD_LOG_WARNING("Failed to load external buffers of {} glTF scene",
+                    filepath);
+    return false;
+  }
+
   /////////////////////////////////////////////////////////////////////////////////
   // MESH LOADING
 
-  std::vector<std::string> mesh_names;
-  std::vector<std::string> node_names;
-
-  for (fastgltf::Mesh& mesh : gltf.meshes) {
-    Mesh new_mesh;
-    new_mesh.name = mesh.name.c_str();
-
-    for (auto&& p : mesh.primitives) {
-      size_t initial_vertex = new_mesh.positions.size();
+  // every primitive gets its own vertex and index range up front, so the
+  // primitives can be decoded in any order and on any thread
+  std::vector<GltfPrimitiveRange> primitive_ranges;
+
+  meshes.resize(gltf.meshes.size());
+
+  for (size_t i = 0; i < gltf.meshes.size(); i++) {
+    fastgltf::Mesh& mesh     = gltf.meshes[i];
+    Mesh&           new_mesh = meshes[i];
+    new_mesh.name            = mesh.name.c_str();
+
+    size_t vertex_count = 0;
+    size_t index_count  = 0;
+
+    for (size_t j = 0; j < mesh.primitives.size(); j++) {
+      fastgltf::Primitive& p = mesh.primitives[j];
+
+      // a malformed primitive fails the import instead of leaving holes or
+      // out of range indices in the mesh
+      if (!is_primitive_valid(gltf, p)) {
+        PXD_LOG_WARNING("Failed to load {} glTF scene, primitive {} of {} "
+                        "has missing or out of bounds accessors",
+                        filepath,
+                        j,
+                        new_mesh.name);
+        return false;
+      }
+
+      primitive_ranges.push_back({ .mesh_index     = i,
+                                   .submesh_index  = j,
+                                   .primitive      = &p,
+                                   .initial_vertex = vertex_count,
+                                   .initial_index  = index_count });
+
+      const size_t primitive_vertices =
+        gltf.accessors[p.findAttribute("POSITION")->second].count;
+      const size_t primitive_indices =
+        p.indicesAccessor.has_value()
+          ? gltf.accessors[*p.indicesAccessor].count
+          : primitive_vertices;
+
+      SubMesh& submesh      = new_mesh.submeshes.emplace_back();
+      submesh.index_offset  = static_cast<uint32_t>(index_count);
+      submesh.index_count   = static_cast<uint32_t>(primitive_indices);
+      submesh.vertex_offset = static_cast<uint32_t>(vertex_count);
+      submesh.vertex_count  = static_cast<uint32_t>(primitive_vertices);
+
+      if (p.materialIndex.has_value()) {
+        submesh.material_index = static_cast<uint32_t>(p.materialIndex.value());
+      }
+
+      vertex_count += primitive_vertices;
+      index_count += primitive_indices;
+    }
 
-      load_indices(gltf, p, new_mesh, initial_vertex);
-      load_positions(gltf, p, new_mesh, initial_vertex);
-      load_normals(gltf, p, new_mesh, initial_vertex);
-      load_uvs(gltf, p, new_mesh, initial_vertex);
+    new_mesh.indices.resize(index_count);
+    new_mesh.positions.resize(vertex_count);
+    new_mesh.normals.resize(vertex_count);
+    new_mesh.uvs.resize(vertex_count);
+  }
 
-      calculate_bounds(new_mesh, initial_vertex);
-    }
+  std::atomic<bool> indices_in_range = true;
+
+  parallel_for(
+    primitive_ranges.size(), options.thread_count, [&](size_t i) {
+      GltfPrimitiveRange& range    = primitive_ranges[i];
+      Mesh&               new_mesh = meshes[range.mesh_index];
+
+      load_indices(gltf,
+                   *range.primitive,
+                   new_mesh,
+                   range.initial_vertex,
+                   range.initial_index);
+      load_positions(gltf, *range.primitive, new_mesh, range.initial_vertex);
+      load_normals(gltf, *range.primitive, new_mesh, range.initial_vertex);
+      load_uvs(gltf, *range.primitive, new_mesh, range.initial_vertex);
+
+      if (!are_indices_in_range(new_mesh,
+                                new_mesh.submeshes[range.submesh_index])) {
+        indices_in_range = false;
+      }
+    });
 
-    mesh_names.push_back(new_mesh.name);
-    meshes.insert({ new_mesh.name, new_mesh });
+  if (!indices_in_range) {
+    PXD_LOG_WARNING(
+      "Failed to load {} glTF scene, a primitive indexes past its vertices",
+      filepath);
+    return false;
   }
 
-  assign_transforms(nodes, meshes, mesh_names, node_names, gltf);
+  calculate_mesh_bounds(
+    meshes, options.thread_count, options.tight_bounding_spheres);
+
+  assign_transforms(nodes, gltf);
 
   /////////////////////////////////////////////////////////////////////////////////
   // PARENT & CHILDREN ASSIGNING
 
-  for (int i = 0; i < gltf.nodes.size(); i++) {
+  // a child has to exist and have a single parent, which also keeps cycles
+  // out of the hierarchy
+  for (uint32_t i = 0; i < gltf.nodes.size(); i++) {
     for (auto& c : gltf.nodes[i].children) {
-      std::string child_node_name  = node_names[c];
-      std::string parent_node_name = node_names[i];
-
-      nodes[child_node_name].parent = &nodes[parent_node_name];
-      nodes[parent_node_name].children.push_back(&nodes[child_node_name]);
+      if (c >= nodes.size() || c == i || nodes[c].parent != INVALID_INDEX) {
+        PXD_LOG_WARNING(
+          "Failed to load {} glTF scene, node {} has an invalid child {}",
+          filepath,
+          i,
+          c);
+        return false;
+      }
+
+      nodes[c].parent = i;
+      nodes[i].children.push_back(static_cast<uint32_t>(c));
     }
   }
 
-  for (auto& [name, node] : nodes) {
-    if (node.parent != nullptr) {
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    if (nodes[i].parent != INVALID_INDEX) {
       continue;
     }
 
-    node.reassign_transforms(glm::mat4{ 1.f });
-    parent_nodes.push_back(&node);
+    parent_nodes.push_back(i);
   }
 
   return true;
@@ -110,15 +523,61 @@ void
 FastGltfImport::load_indices(fastgltf::Asset&     gltf,
                              fastgltf::Primitive& p,
                              Mesh&                new_mesh,
-                             size_t               initial_vertex)
+                             size_t               initial_vertex,
+                             size_t               initial_index)
 {
-  fastgltf::Accessor& index_accessor =
-    gltf.accessors[p.indicesAccessor.value()];
-  new_mesh.indices.reserve(new_mesh.indices.size() + index_accessor.count);
+  uint32_t*      destination = new_mesh.indices.data() + initial_index;
+  const uint32_t offset      = static_cast<uint32_t>(initial_vertex);
+
+  // non-indexed primitives draw their vertices in order
+  if (!p.indicesAccessor.has_value()) {
+    const size_t vertex_count =
+      gltf.accessors[p.findAttribute("POSITION")->second].count;
+
+    for (size_t i = 0; i < vertex_count; i++) {
+      destination[i] = offset + static_cast<uint32_t>(i);
+    }
+    return;
+  }
+
+  fastgltf::Accessor& index_accessor = gltf.accessors[*p.indicesAccessor];
+
+  const std::byte* packed_data =
+    get_packed_accessor_data(gltf,
+                             index_accessor,
+                             fastgltf::AccessorType::Scalar,
+                             index_accessor.componentType);
+
+  if (packed_data != nullptr) {
+    switch (index_accessor.componentType) {
+      case fastgltf::ComponentType::UnsignedByte:
+        copy_indices_with_offset(reinterpret_cast<const uint8_t*>(packed_data),
+                                 destination,
+                                 index_accessor.count,
+                                 offset);
+        return;
+      case fastgltf::ComponentType::UnsignedShort:
+        copy_indices_with_offset(
+          reinterpret_cast<const uint16_t*>(packed_data),
+          destination,
+          index_accessor.count,
+          offset);
+        return;
+      case fastgltf::ComponentType::UnsignedInt:
+        copy_indices_with_offset(
+          reinterpret_cast<const uint32_t*>(packed_data),
+          destination,
+          index_accessor.count,
+          offset);
+        return;
+      default:
+        break;
+    }
+  }
 
-  fastgltf::iterateAccessor<std::uint32_t>(
-    gltf, index_accessor, [&](std::uint32_t idx) {
-      new_mesh.indices.push_back(idx + initial_vertex);
+  fastgltf::iterateAccessorWithIndex<std::uint32_t>(
+    gltf, index_accessor, [&](std::uint32_t idx, size_t index) {
+      new_mesh.indices[initial_index + index] = idx + initial_vertex;
     });
 }
 
@@ -131,9 +590,18 @@ FastGltfImport::load_positions(fastgltf::Asset&     gltf,
   fastgltf::Accessor& pos_accessor =
     gltf.accessors[p.findAttribute("POSITION")->second];
 
-  new_mesh.positions.resize(new_mesh.positions.size() + pos_accessor.count);
-  new_mesh.normals.resize(new_mesh.normals.size() + pos_accessor.count);
-  new_mesh.uvs.resize(new_mesh.uvs.size() + pos_accessor.count);
+  const std::byte* packed_data =
+    get_packed_accessor_data(gltf,
+                             pos_accessor,
+                             fastgltf::AccessorType::Vec3,
+                             fastgltf::ComponentType::Float);
+
+  if (packed_data != nullptr) {
+    copy_packed_floats<glm::vec3, 3>(packed_data,
+                                     new_mesh.positions.data() + initial_vertex,
+                                     pos_accessor.count);
+    return;
+  }
 
   fastgltf::iterateAccessorWithIndex<glm::vec3>(
     gltf, pos_accessor, [&](glm::vec3 v, size_t index) {
@@ -148,12 +616,29 @@ FastGltfImport::load_normals(fastgltf::Asset&     gltf,
                              size_t               initial_vertex)
 {
   auto normals = p.findAttribute("NORMAL");
-  if (normals != p.attributes.end()) {
-    fastgltf::iterateAccessorWithIndex<glm::vec3>(
-      gltf, gltf.accessors[(*normals).second], [&](glm::vec3 v, size_t index) {
-        new_mesh.normals[initial_vertex + index] = v;
-      });
+  if (normals == p.attributes.end()) {
+    return;
+  }
+
+  fastgltf::Accessor& normal_accessor = gltf.accessors[(*normals).second];
+
+  const std::byte* packed_data =
+    get_packed_accessor_data(gltf,
+                             normal_accessor,
+                             fastgltf::AccessorType::Vec3,
+                             fastgltf::ComponentType::Float);
+
+  if (packed_data != nullptr) {
+    copy_packed_floats<glm::vec3, 3>(packed_data,
+                                     new_mesh.normals.data() + initial_vertex,
+                                     normal_accessor.count);
+    return;
   }
+
+  fastgltf::iterateAccessorWithIndex<glm::vec3>(
+    gltf, normal_accessor, [&](glm::vec3 v, size_t index) {
+      new_mesh.normals[initial_vertex + index] = v;
+    });
 }
 
 void
@@ -163,45 +648,42 @@ FastGltfImport::load_uvs(fastgltf::Asset&     gltf,
                          size_t               initial_vertex)
 {
   auto uv = p.findAttribute("TEXCOORD_0");
-  if (uv != p.attributes.end()) {
-    fastgltf::iterateAccessorWithIndex<glm::vec2>(
-      gltf, gltf.accessors[(*uv).second], [&](glm::vec2 v, size_t index) {
-        new_mesh.uvs[initial_vertex + index] = v;
-      });
+  if (uv == p.attributes.end()) {
+    return;
   }
-}
 
-void
-FastGltfImport::calculate_bounds(Mesh& new_mesh, size_t initial_vertex)
-{
-  glm::vec3 min_pos = new_mesh.positions[initial_vertex];
-  glm::vec3 max_pos = min_pos;
+  fastgltf::Accessor& uv_accessor = gltf.accessors[(*uv).second];
+
+  const std::byte* packed_data =
+    get_packed_accessor_data(gltf,
+                             uv_accessor,
+                             fastgltf::AccessorType::Vec2,
+                             fastgltf::ComponentType::Float);
 
-  for (int i = initial_vertex; i < new_mesh.positions.size(); i++) {
-    min_pos = glm::min(min_pos, new_mesh.positions[i]);
-    max_pos = glm::max(max_pos, new_mesh.positions[i]);
+  if (packed_data != nullptr) {
+    copy_packed_floats<glm::vec2, 2>(
+      packed_data, new_mesh.uvs.data() + initial_vertex, uv_accessor.count);
+    return;
   }
 
-  new_mesh.bounds.aabb_min      = min_pos;
-  new_mesh.bounds.aabb_max      = max_pos;
-  new_mesh.bounds.sphere_radius = glm::length(max_pos - min_pos) / 2.f;
+  fastgltf::iterateAccessorWithIndex<glm::vec2>(
+    gltf, uv_accessor, [&](glm::vec2 v, size_t index) {
+      new_mesh.uvs[initial_vertex + index] = v;
+    });
 }
 
 void
-FastGltfImport::assign_transforms(
-  absl::flat_hash_map<std::string, MeshNode>& _nodes,
-  absl::flat_hash_map<std::string, Mesh>&     _meshes,
-  std::vector<std::string>&                   _mesh_names,
-  std::vector<std::string>&                   _node_names,
-  fastgltf::Asset&                            gltf)
+FastGltfImport::assign_transforms(std::vector<MeshNode>& _nodes,
+                                  fastgltf::Asset&       gltf)
 {
+  _nodes.reserve(gltf.nodes.size());
+
   for (fastgltf::Node& node : gltf.nodes) {
     MeshNode new_node;
     new_node.name = node.name.c_str();
 
     if (node.meshIndex.has_value()) {
-      std::string mesh_name = _mesh_names[*node.meshIndex];
-      new_node.meshes.push_back(&_meshes[mesh_name]);
+      new_node.meshes.push_back(static_cast<uint32_t>(*node.meshIndex));
     }
 
     std::visit(
@@ -228,8 +710,7 @@ FastGltfImport::assign_transforms(
         } },
       node.transform);
 
-    _node_names.push_back(new_node.name);
-    _nodes.insert({ new_node.name, new_node });
+    _nodes.push_back(std::move(new_node));
   }
 }
 }
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "mapped_file.hpp"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace pxd::ass {
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+  : m_data(std::exchange(other.m_data, nullptr))
+  , m_size(std::exchange(other.m_size, 0))
+  , m_mapped_size(std::exchange(other.m_mapped_size, 0))
+{
+}
+
+MappedFile&
+MappedFile::operator=(MappedFile&& other) noexcept
+{
+  if (this != &other) {
+    close();
+
+    m_data        = std::exchange(other.m_data, nullptr);
+    m_size        = std::exchange(other.m_size, 0);
+    m_mapped_size = std::exchange(other.m_mapped_size, 0);
+  }
+
+  return *this;
+}
+
+#if defined(_WIN32)
+
+auto
+MappedFile::open(const std::filesystem::path& path, size_t padding) -> bool
+{
+  close();
+
+  HANDLE file = CreateFileW(path.c_str(),
+                            GENERIC_READ,
+                            FILE_SHARE_READ,
+                            nullptr,
+                            OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN,
+                            nullptr);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  SYSTEM_INFO   system_info;
+  GetSystemInfo(&system_info);
+
+  const size_t page_size = system_info.dwPageSize;
+
+  // a read-only file mapping cannot grow past the file, so the padding has to
+  // fit in the zero-filled tail of the last page
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ||
+      (padding > 0 && (file_size.QuadPart % page_size == 0 ||
+                       page_size - file_size.QuadPart % page_size < padding))) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping =
+    CreateFileMappingW(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+
+  if (mapping == nullptr) {
+    return false;
+  }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+  CloseHandle(mapping);
+
+  if (view == nullptr) {
+    return false;
+  }
+
+  m_data        = static_cast<uint8_t*>(view);
+  m_size        = static_cast<size_t>(file_size.QuadPart);
+  m_mapped_size = m_size;
+
+  return true;
+}
+
+void
+MappedFile::close()
+{
+  if (m_data != nullptr) {
+    UnmapViewOfFile(m_data);
+  }
+
+  m_data        = nullptr;
+  m_size        = 0;
+  m_mapped_size = 0;
+}
+
+void
+MappedFile::advise_sequential()
+{
+  // FILE_FLAG_SEQUENTIAL_SCAN is already set when the file is opened
+}
+
+#else
+
+auto
+MappedFile::open(const std::filesystem::path& path, size_t padding) -> bool
+{
+  close();
+
+  int file = ::open(path.c_str(), O_RDONLY);
+
+  if (file < 0) {
+    return false;
+  }
+
+  struct stat file_stat;
+
+  if (fstat(file, &file_stat) != 0 || file_stat.st_size <= 0) {
+    ::close(file);
+    return false;
+  }
+
+  const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  const size_t file_size = static_cast<size_t>(file_stat.st_size);
+  const size_t mapped_size =
+    (file_size + padding + page_size - 1) / page_size * page_size;
+
+  // reserve the padded range with zero pages first, then place the file on
+  // top of it, the padding then reads as zeros instead of faulting
+  void* reserved = mmap(nullptr,
+                        mapped_size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1,
+                        0);
+
+  if (reserved == MAP_FAILED) {
+    ::close(file);
+    return false;
+  }
+
+  void* view = mmap(reserved,
+                    file_size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_FIXED,
+                    file,
+                    0);
+  ::close(file);
+
+  if (view == MAP_FAILED) {
+    munmap(reserved, mapped_size);
+    return false;
+  }
+
+  m_data        = static_cast<uint8_t*>(view);
+  m_size        = file_size;
+  m_mapped_size = mapped_size;
+
+  return true;
+}
+
+void
+MappedFile::close()
+{
+  if (m_data != nullptr) {
+    munmap(m_data, m_mapped_size);
+  }
+
+  m_data        = nullptr;
+  m_size        = 0;
+  m_mapped_size = 0;
+}
+
+void
+MappedFile::advise_sequential()
+{
+  if (m_data != nullptr) {
+    madvise(m_data, m_mapped_size, MADV_SEQUENTIAL);
+  }
+}
+
+#endif
+
+} // namespace pxd::ass
@@ -0,0 +1,1010 @@
+#include "mesh_bvh.hpp"
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <numeric>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace pxd::ass {
+
+constexpr uint32_t MESH_BVH_BIN_COUNT = 16;
+// cost of visiting a node relative to one triangle test
+constexpr float MESH_BVH_TRAVERSAL_COST = 1.f;
+// traversal pushes at most one sibling per level plus the two children of the
+// deepest node
+constexpr size_t MESH_BVH_STACK_SIZE = MESH_BVH_MAX_DEPTH + 2;
+
+struct MeshBvhBin
+{
+  glm::vec3 aabb_min = glm::vec3{ std::numeric_limits<float>::max() };
+  glm::vec3 aabb_max = glm::vec3{ -std::numeric_limits<float>::max() };
+  uint32_t  count    = 0;
+};
+
+// per triangle bounds that only live during the build, order is the leaf
+// order permutation whose node ranges are partitioned in place
+struct MeshBvhBuild
+{
+  std::vector<glm::vec3> triangle_min;
+  std::vector<glm::vec3> triangle_max;
+  std::vector<glm::vec3> centroids;
+  std::vector<uint32_t>  order;
+};
+
+struct MeshBvhStackEntry
+{
+  uint32_t node_index;
+  float    distance;
+};
+
+auto
+get_surface_area(const glm::vec3& aabb_min, const glm::vec3& aabb_max) -> float
+{
+  const glm::vec3 extent = aabb_max - aabb_min;
+  return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+// ranges are cut into MESH_BVH_TASK_TRIANGLES chunks for the parallel passes
+// and the chunk results are merged in order, so the outcome does not depend on
+// the number of workers
+auto
+get_build_chunk_count(uint32_t count) -> size_t
+{
+  return (count + MESH_BVH_TASK_TRIANGLES - 1) / MESH_BVH_TASK_TRIANGLES;
+}
+
+// aabb and centroid bounds of the triangles in [begin, end) of the order
+void
+bound_range_chunk(const MeshBvhBuild& build,
+                  uint32_t            begin,
+                  uint32_t            end,
+                  glm::vec3 (&out_bounds)[4])
+{
+  glm::vec3 aabb_min     = build.triangle_min[build.order[begin]];
+  glm::vec3 aabb_max     = build.triangle_max[build.order[begin]];
+  glm::vec3 centroid_min = build.centroids[build.order[begin]];
+  glm::vec3 centroid_max = centroid_min;
+
+  for (uint32_t i = begin + 1; i < end; i++) {
+    const uint32_t t = build.order[i];
+
+    aabb_min     = glm::min(aabb_min, build.triangle_min[t]);
+    aabb_max     = glm::max(aabb_max, build.triangle_max[t]);
+    centroid_min = glm::min(centroid_min, build.centroids[t]);
+    centroid_max = glm::max(centroid_max, build.centroids[t]);
+  }
+
+  out_bounds[0] = aabb_min;
+  out_bounds[1] = aabb_max;
+  out_bounds[2] = centroid_min;
+  out_bounds[3] = centroid_max;
+}
+
+void
+calculate_range_bounds(const MeshBvhBuild& build,
+                       uint32_t            first,
+                       uint32_t            count,
+                       uint32_t            thread_count,
+                       glm::vec3 (&out_bounds)[4])
+{
+  const size_t chunk_count = get_build_chunk_count(count);
+
+  if (chunk_count == 1) {
+    bound_range_chunk(build, first, first + count, out_bounds);
+    return;
+  }
+
+  std::vector<glm::vec3> chunk_bounds(chunk_count * 4);
+
+  parallel_for(chunk_count, thread_count, [&](size_t c) {
+    const uint32_t begin =
+      first + static_cast<uint32_t>(c * MESH_BVH_TASK_TRIANGLES);
+    const uint32_t end = std::min(
+      first + count, begin + static_cast<uint32_t>(MESH_BVH_TASK_TRIANGLES));
+
+    glm::vec3 bounds[4];
+    bound_range_chunk(build, begin, end, bounds);
+    std::copy(bounds, bounds + 4, chunk_bounds.begin() + c * 4);
+  });
+
+  std::copy(chunk_bounds.begin(), chunk_bounds.begin() + 4, out_bounds);
+
+  for (size_t c = 1; c < chunk_count; c++) {
+    out_bounds[0] = glm::min(out_bounds[0], chunk_bounds[c * 4]);
+    out_bounds[1] = glm::max(out_bounds[1], chunk_bounds[c * 4 + 1]);
+    out_bounds[2] = glm::min(out_bounds[2], chunk_bounds[c * 4 + 2]);
+    out_bounds[3] = glm::max(out_bounds[3], chunk_bounds[c * 4 + 3]);
+  }
+}
+
+auto
+get_bin_index(const glm::vec3& centroid,
+              const glm::vec3& centroid_min,
+              const glm::vec3& bin_scale,
+              int              axis) -> uint32_t
+{
+  const int bin =
+    static_cast<int>((centroid[axis] - centroid_min[axis]) * bin_scale[axis]);
+
+  return static_cast<uint32_t>(
+    std::clamp(bin, 0, static_cast<int>(MESH_BVH_BIN_COUNT) - 1));
+}
+
+using MeshBvhBins = std::array<MeshBvhBin, 3 * MESH_BVH_BIN_COUNT>;
+
+// bins the triangles in [begin, end) of the order along all three axes, bin
+// b of an axis is out_bins[axis * MESH_BVH_BIN_COUNT + b]
+void
+bin_range_chunk(const MeshBvhBuild& build,
+                uint32_t            begin,
+                uint32_t            end,
+                const glm::vec3&    centroid_min,
+                const glm::vec3&    bin_scale,
+                MeshBvhBins&        out_bins)
+{
+  for (uint32_t i = begin; i < end; i++) {
+    const uint32_t t = build.order[i];
+
+    for (int axis = 0; axis < 3; axis++) {
+      const uint32_t b =
+        get_bin_index(build.centroids[t], centroid_min, bin_scale, axis);
+      MeshBvhBin& bin = out_bins[axis * MESH_BVH_BIN_COUNT + b];
+
+      bin.aabb_min = glm::min(bin.aabb_min, build.triangle_min[t]);
+      bin.aabb_max = glm::max(bin.aabb_max, build.triangle_max[t]);
+      bin.count++;
+    }
+  }
+}
+
+void
+bin_range(const MeshBvhBuild& build,
+          uint32_t            first,
+          uint32_t            count,
+          uint32_t            thread_count,
+          const glm::vec3&    centroid_min,
+          const glm::vec3&    bin_scale,
+          MeshBvhBins&        out_bins)
+{
+  const size_t chunk_count = get_build_chunk_count(count);
+
+  if (chunk_count == 1) {
+    bin_range_chunk(
+      build, first, first + count, centroid_min, bin_scale, out_bins);
+    return;
+  }
+
+  std::vector<MeshBvhBins> chunk_bins(chunk_count);
+
+  parallel_for(chunk_count, thread_count, [&](size_t c) {
+    const uint32_t begin =
+      first + static_cast<uint32_t>(c * MESH_BVH_TASK_TRIANGLES);
+    const uint32_t end = std::min(
+      first + count, begin + static_cast<uint32_t>(MESH_BVH_TASK_TRIANGLES));
+
+    bin_range_chunk(build, begin, end, centroid_min, bin_scale, chunk_bins[c]);
+  });
+
+  for (const MeshBvhBins& bins : chunk_bins) {
+    for (size_t b = 0; b < bins.size(); b++) {
+      out_bins[b].aabb_min = glm::min(out_bins[b].aabb_min, bins[b].aabb_min);
+      out_bins[b].aabb_max = glm::max(out_bins[b].aabb_max, bins[b].aabb_max);
+      out_bins[b].count += bins[b].count;
+    }
+  }
+}
+
+// Computes the bounds of nodes[node_index] and splits its triangle range in
+// two when the surface area heuristic favours it over a leaf. Leaves too large
+// for MESH_BVH_MAX_LEAF_SIZE are always split. Returns false for leaves.
+auto
+split_mesh_bvh_node(MeshBvhBuild&             build,
+                    std::vector<MeshBvhNode>& nodes,
+                    uint32_t                  node_index,
+                    uint32_t                  depth,
+                    uint32_t                  thread_count) -> bool
+{
+  const uint32_t first = nodes[node_index].first;
+  const uint32_t count = nodes[node_index].triangle_count;
+
+  glm::vec3 bounds[4];
+  calculate_range_bounds(build, first, count, thread_count, bounds);
+
+  nodes[node_index].aabb_min = bounds[0];
+  nodes[node_index].aabb_max = bounds[1];
+
+  const glm::vec3 centroid_min = bounds[2];
+  const glm::vec3 centroid_max = bounds[3];
+
+  if (count <= 1) {
+    return false;
+  }
+
+  const glm::vec3 centroid_extent = centroid_max - centroid_min;
+
+  glm::vec3 bin_scale;
+
+  for (int axis = 0; axis < 3; axis++) {
+    bin_scale[axis] = centroid_extent[axis] > 0.f
+                        ? MESH_BVH_BIN_COUNT / centroid_extent[axis]
+                        : 0.f;
+  }
+
+  int      best_axis  = -1;
+  uint32_t best_split = 0;
+  float    best_cost  = std::numeric_limits<float>::max();
+
+  if (depth + 32 < MESH_BVH_MAX_DEPTH) {
+    MeshBvhBins bins;
+    bin_range(build, first, count, thread_count, centroid_min, bin_scale, bins);
+
+    for (int axis = 0; axis < 3; axis++) {
+      if (centroid_extent[axis] <= 0.f) {
+        continue;
+      }
+
+      const MeshBvhBin* axis_bins = bins.data() + axis * MESH_BVH_BIN_COUNT;
+
+      // left_costs[b] is the cost of the bins before split b
+      float      left_costs[MESH_BVH_BIN_COUNT];
+      uint32_t   left_counts[MESH_BVH_BIN_COUNT];
+      MeshBvhBin left;
+
+      for (uint32_t b = 1; b < MESH_BVH_BIN_COUNT; b++) {
+        left.aabb_min = glm::min(left.aabb_min, axis_bins[b - 1].aabb_min);
+        left.aabb_max = glm::max(left.aabb_max, axis_bins[b - 1].aabb_max);
+        left.count += axis_bins[b - 1].count;
+
+        left_counts[b] = left.count;
+        left_costs[b] =
+          left.count > 0
+            ? left.count * get_surface_area(left.aabb_min, left.aabb_max)
+            : 0.f;
+      }
+
+      MeshBvhBin right;
+
+      for (uint32_t b = MESH_BVH_BIN_COUNT - 1; b > 0; b--) {
+        right.aabb_min = glm::min(right.aabb_min, axis_bins[b].aabb_min);
+        right.aabb_max = glm::max(right.aabb_max, axis_bins[b].aabb_max);
+        right.count += axis_bins[b].count;
+
+        if (left_counts[b] == 0 || right.count == 0) {
+          continue;
+        }
+
+        const float cost =
+          left_costs[b] +
+          right.count * get_surface_area(right.aabb_min, right.aabb_max);
+
+        if (cost < best_cost) {
+          best_axis  = axis;
+          best_split = b;
+          best_cost  = cost;
+        }
+      }
+    }
+  }
+
+  const float node_area = get_surface_area(nodes[node_index].aabb_min,
+                                           nodes[node_index].aabb_max);
+  const float leaf_cost = count * node_area;
+
+  uint32_t left_count;
+
+  if (best_axis >= 0 &&
+      (MESH_BVH_TRAVERSAL_COST * node_area + best_cost < leaf_cost ||
+       count > MESH_BVH_MAX_LEAF_SIZE)) {
+    const auto begin  = build.order.begin() + first;
+    const auto middle = std::partition(begin, begin + count, [&](uint32_t t) {
+      return get_bin_index(
+               build.centroids[t], centroid_min, bin_scale, best_axis) <
+             best_split;
+    });
+
+    left_count = static_cast<uint32_t>(middle - begin);
+  } else if (count > MESH_BVH_MAX_LEAF_SIZE) {
+    // the centroids coincide or the tree is too deep, any even split will do
+    left_count = count / 2;
+  } else {
+    return false;
+  }
+
+  const uint32_t left_child = static_cast<uint32_t>(nodes.size());
+
+  nodes[node_index].first          = left_child;
+  nodes[node_index].triangle_count = 0;
+
+  nodes.push_back({ .first = first, .triangle_count = left_count });
+  nodes.push_back(
+    { .first = first + left_count, .triangle_count = count - left_count });
+
+  return true;
+}
+
+// builds the tree below root on the calling thread, out_nodes[0] is root and
+// child indices are local to out_nodes
+void
+build_mesh_bvh_subtree(MeshBvhBuild&             build,
+                       const MeshBvhNode&        root,
+                       uint32_t                  root_depth,
+                       std::vector<MeshBvhNode>& out_nodes)
+{
+  out_nodes = { root };
+
+  std::vector<uint32_t> node_stack = { 0 };
+  std::vector<uint32_t> depths     = { root_depth };
+
+  while (!node_stack.empty()) {
+    const uint32_t node_index = node_stack.back();
+    const uint32_t depth      = depths.back();
+    node_stack.pop_back();
+    depths.pop_back();
+
+    if (split_mesh_bvh_node(build, out_nodes, node_index, depth, 1)) {
+      const uint32_t left_child = out_nodes[node_index].first;
+
+      node_stack.push_back(left_child + 1);
+      node_stack.push_back(left_child);
+      depths.push_back(depth + 1);
+      depths.push_back(depth + 1);
+    }
+  }
+}
+
+void
+MeshBvh::build(std::span<const glm::vec3> positions,
+               std::span<const uint32_t>  indices,
+               uint32_t                   thread_count)
+{
+  clear();
+
+  const uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+  if (triangle_count == 0) {
+    return;
+  }
+
+  MeshBvhBuild build;
+  build.triangle_min.resize(triangle_count);
+  build.triangle_max.resize(triangle_count);
+  build.centroids.resize(triangle_count);
+  build.order.resize(triangle_count);
+  std::iota(build.order.begin(), build.order.end(), 0);
+
+  const size_t chunk_count = get_build_chunk_count(triangle_count);
+
+  parallel_for(chunk_count, thread_count, [&](size_t chunk) {
+    const size_t begin = chunk * MESH_BVH_TASK_TRIANGLES;
+    const size_t end =
+      std::min<size_t>(triangle_count, begin + MESH_BVH_TASK_TRIANGLES);
+
+    for (size_t t = begin; t < end; t++) {
+      const glm::vec3& a = positions[indices[t * 3]];
+      const glm::vec3& b = positions[indices[t * 3 + 1]];
+      const glm::vec3& c = positions[indices[t * 3 + 2]];
+
+      build.triangle_min[t] = glm::min(a, glm::min(b, c));
+      build.triangle_max[t] = glm::max(a, glm::max(b, c));
+      build.centroids[t] =
+        (build.triangle_min[t] + build.triangle_max[t]) * 0.5f;
+    }
+  });
+
+  // Ranges larger than one task are split here with every worker binning, the
+  // rest are collected as subtrees. Which ranges become subtrees only depends
+  // on their size, so the tree does not change with thread_count.
+  nodes.push_back({ .first = 0, .triangle_count = triangle_count });
+
+  std::vector<uint32_t> node_stack = { 0 };
+  std::vector<uint32_t> depths     = { 0 };
+  std::vector<uint32_t> subtree_roots;
+  std::vector<uint32_t> subtree_depths;
+
+  while (!node_stack.empty()) {
+    const uint32_t node_index = node_stack.back();
+    const uint32_t depth      = depths.back();
+    node_stack.pop_back();
+    depths.pop_back();
+
+    if (nodes[node_index].triangle_count <= MESH_BVH_TASK_TRIANGLES) {
+      subtree_roots.push_back(node_index);
+      subtree_depths.push_back(depth);
+      continue;
+    }
+
+    if (split_mesh_bvh_node(build, nodes, node_index, depth, thread_count)) {
+      const uint32_t left_child = nodes[node_index].first;
+
+      node_stack.push_back(left_child + 1);
+      node_stack.push_back(left_child);
+      depths.push_back(depth + 1);
+      depths.push_back(depth + 1);
+    }
+  }
+
+  std::vector<std::vector<MeshBvhNode>> subtrees(subtree_roots.size());
+
+  parallel_for(subtree_roots.size(), thread_count, [&](size_t s) {
+    build_mesh_bvh_subtree(
+      build, nodes[subtree_roots[s]], subtree_depths[s], subtrees[s]);
+  });
+
+  // the subtree root replaces its placeholder and the other nodes are
+  // appended, local node k > 0 lands at base + k
+  for (size_t s = 0; s < subtrees.size(); s++) {
+    const uint32_t base = static_cast<uint32_t>(nodes.size()) - 1;
+
+    for (MeshBvhNode& node : subtrees[s]) {
+      if (node.triangle_count == 0) {
+        node.first += base;
+      }
+    }
+
+    nodes[subtree_roots[s]] = subtrees[s][0];
+    nodes.insert(nodes.end(), subtrees[s].begin() + 1, subtrees[s].end());
+  }
+
+  triangle_corners.resize(triangle_count);
+  triangle_edges1.resize(triangle_count);
+  triangle_edges2.resize(triangle_count);
+  triangle_indices = std::move(build.order);
+
+  parallel_for(chunk_count, thread_count, [&](size_t chunk) {
+    const size_t begin = chunk * MESH_BVH_TASK_TRIANGLES;
+    const size_t end =
+      std::min<size_t>(triangle_count, begin + MESH_BVH_TASK_TRIANGLES);
+
+    for (size_t i = begin; i < end; i++) {
+      const size_t     t = triangle_indices[i];
+      const glm::vec3& a = positions[indices[t * 3]];
+
+      triangle_corners[i] = a;
+      triangle_edges1[i]  = positions[indices[t * 3 + 1]] - a;
+      triangle_edges2[i]  = positions[indices[t * 3 + 2]] - a;
+    }
+  });
+}
+
+void
+MeshBvh::clear()
+{
+  nodes.clear();
+  triangle_corners.clear();
+  triangle_edges1.clear();
+  triangle_edges2.clear();
+  triangle_indices.clear();
+}
+
+// entry distance of the ray into the node's box, max float when it misses
+// the box or enters it beyond t_max
+auto
+intersect_ray_aabb(const MeshBvhNode& node,
+                   const glm::vec3&   origin,
+                   const glm::vec3&   inverse_direction,
+                   float              t_min,
+                   float              t_max) -> float
+{
+  float t_near = t_min;
+  float t_far  = t_max;
+
+  for (int axis = 0; axis < 3; axis++) {
+    const float t0 =
+      (node.aabb_min[axis] - origin[axis]) * inverse_direction[axis];
+    const float t1 =
+      (node.aabb_max[axis] - origin[axis]) * inverse_direction[axis];
+
+    t_near = std::max(t_near, std::min(t0, t1));
+    t_far  = std::min(t_far, std::max(t0, t1));
+  }
+
+  return t_near <= t_far ? t_near : std::numeric_limits<float>::max();
+}
+
+// Moller-Trumbore, hits in [ray.t_min, t_max] are accepted
+auto
+intersect_ray_triangle(const Ray&       ray,
+                       const glm::vec3& corner,
+                       const glm::vec3& edge1,
+                       const glm::vec3& edge2,
+                       float            t_max,
+                       RayHit&          out_hit) -> bool
+{
+  const glm::vec3 p           = glm::cross(ray.direction, edge2);
+  const float     determinant = glm::dot(edge1, p);
+
+  if (determinant == 0.f) {
+    return false;
+  }
+
+  const float     inverse_determinant = 1.f / determinant;
+  const glm::vec3 s                   = ray.origin - corner;
+  const float     u                   = glm::dot(s, p) * inverse_determinant;
+
+  if (u < 0.f || u > 1.f) {
+    return false;
+  }
+
+  const glm::vec3 q = glm::cross(s, edge1);
+  const float     v = glm::dot(ray.direction, q) * inverse_determinant;
+
+  if (v < 0.f || u + v > 1.f) {
+    return false;
+  }
+
+  const float t = glm::dot(edge2, q) * inverse_determinant;
+
+  if (t < ray.t_min || t > t_max) {
+    return false;
+  }
+
+  out_hit.t = t;
+  out_hit.u = u;
+  out_hit.v = v;
+
+  return true;
+}
+
+auto
+MeshBvh::traverse(const Ray& ray, bool any_hit, RayHit& out_hit) const -> bool
+{
+  if (nodes.empty()) {
+    return false;
+  }
+
+  const glm::vec3 inverse_direction = { 1.f / ray.direction.x,
+                                        1.f / ray.direction.y,
+                                        1.f / ray.direction.z };
+
+  float t_max = ray.t_max;
+  bool  hit   = false;
+
+  MeshBvhStackEntry node_stack[MESH_BVH_STACK_SIZE];
+  size_t            stack_size = 0;
+
+  const float root_distance = intersect_ray_aabb(
+    nodes[0], ray.origin, inverse_direction, ray.t_min, t_max);
+
+  if (root_distance == std::numeric_limits<float>::max()) {
+    return false;
+  }
+
+  node_stack[stack_size++] = { 0, root_distance };
+
+  while (stack_size > 0) {
+    const MeshBvhStackEntry entry = node_stack[--stack_size];
+
+    if (entry.distance > t_max) {
+      continue;
+    }
+
+    const MeshBvhNode& node = nodes[entry.node_index];
+
+    if (node.triangle_count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.triangle_count;
+           i++) {
+        RayHit triangle_hit;
+
+        if (intersect_ray_triangle(ray,
+                                   triangle_corners[i],
+                                   triangle_edges1[i],
+                                   triangle_edges2[i],
+                                   t_max,
+                                   triangle_hit)) {
+          triangle_hit.triangle = triangle_indices[i];
+          out_hit               = triangle_hit;
+          t_max                 = triangle_hit.t;
+          hit                   = true;
+
+          if (any_hit) {
+            return true;
+          }
+        }
+      }
+      continue;
+    }
+
+    MeshBvhStackEntry near_child = {
+      node.first,
+      intersect_ray_aabb(
+        nodes[node.first], ray.origin, inverse_direction, ray.t_min, t_max)
+    };
+    MeshBvhStackEntry far_child = {
+      node.first + 1,
+      intersect_ray_aabb(
+        nodes[node.first + 1], ray.origin, inverse_direction, ray.t_min, t_max)
+    };
+
+    if (far_child.distance < near_child.distance) {
+      std::swap(near_child, far_child);
+    }
+
+    if (far_child.distance != std::numeric_limits<float>::max()) {
+      node_stack[stack_size++] = far_child;
+    }
+    if (near_child.distance != std::numeric_limits<float>::max()) {
+      node_stack[stack_size++] = near_child;
+    }
+  }
+
+  return hit;
+}
+
+auto
+MeshBvh::intersect(const Ray& ray, RayHit& out_hit) const -> bool
+{
+  return traverse(ray, false, out_hit);
+}
+
+auto
+MeshBvh::occluded(const Ray& ray) const -> bool
+{
+  RayHit hit;
+  return traverse(ray, true, hit);
+}
+
+#if defined(__AVX2__)
+// a * b + c and a * b - c, the build only enables AVX2 and not FMA
+auto
+multiply_add(__m256 a, __m256 b, __m256 c) -> __m256
+{
+  return _mm256_add_ps(_mm256_mul_ps(a, b), c);
+}
+
+auto
+multiply_subtract(__m256 a, __m256 b, __m256 c) -> __m256
+{
+  return _mm256_sub_ps(_mm256_mul_ps(a, b), c);
+}
+#endif
+
+void
+MeshBvh::intersect(const RayPacket& packet, RayPacketHit& out_hits) const
+{
+#if defined(__AVX2__)
+  const __m256 origin_x    = _mm256_loadu_ps(packet.origin_x);
+  const __m256 origin_y    = _mm256_loadu_ps(packet.origin_y);
+  const __m256 origin_z    = _mm256_loadu_ps(packet.origin_z);
+  const __m256 direction_x = _mm256_loadu_ps(packet.direction_x);
+  const __m256 direction_y = _mm256_loadu_ps(packet.direction_y);
+  const __m256 direction_z = _mm256_loadu_ps(packet.direction_z);
+  const __m256 t_min       = _mm256_loadu_ps(packet.t_min);
+
+  const __m256 one                 = _mm256_set1_ps(1.f);
+  const __m256 zero                = _mm256_setzero_ps();
+  const __m256 inverse_direction_x = _mm256_div_ps(one, direction_x);
+  const __m256 inverse_direction_y = _mm256_div_ps(one, direction_y);
+  const __m256 inverse_direction_z = _mm256_div_ps(one, direction_z);
+
+  __m256  t_max    = _mm256_loadu_ps(packet.t_max);
+  __m256  hit_u    = zero;
+  __m256  hit_v    = zero;
+  __m256i triangle = _mm256_set1_epi32(static_cast<int>(INVALID_INDEX));
+
+  const __m256 active = _mm256_cmp_ps(t_min, t_max, _CMP_LE_OQ);
+
+  uint32_t node_stack[MESH_BVH_STACK_SIZE];
+  size_t   stack_size = 0;
+
+  if (!nodes.empty() && _mm256_movemask_ps(active) != 0) {
+    node_stack[stack_size++] = 0;
+  }
+
+  while (stack_size > 0) {
+    const MeshBvhNode& node = nodes[node_stack[--stack_size]];
+
+    // slab test of every lane against the box, lanes that already hit
+    // something closer than the box drop out through t_max
+    const __m256 t0_x = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_set1_ps(node.aabb_min.x), origin_x),
+      inverse_direction_x);
+    const __m256 t1_x = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_set1_ps(node.aabb_max.x), origin_x),
+      inverse_direction_x);
+    const __m256 t0_y = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_set1_ps(node.aabb_min.y), origin_y),
+      inverse_direction_y);
+    const __m256 t1_y = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_set1_ps(node.aabb_max.y), origin_y),
+      inverse_direction_y);
+    const __m256 t0_z = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_set1_ps(node.aabb_min.z), origin_z),
+      inverse_direction_z);
+    const __m256 t1_z = _mm256_mul_ps(
+      _mm256_sub_ps(_mm256_set1_ps(node.aabb_max.z), origin_z),
+      inverse_direction_z);
+
+    const __m256 t_near = _mm256_max_ps(
+      _mm256_max_ps(t_min, _mm256_min_ps(t0_x, t1_x)),
+      _mm256_max_ps(_mm256_min_ps(t0_y, t1_y), _mm256_min_ps(t0_z, t1_z)));
+    const __m256 t_far = _mm256_min_ps(
+      _mm256_min_ps(t_max, _mm256_max_ps(t0_x, t1_x)),
+      _mm256_min_ps(_mm256_max_ps(t0_y, t1_y), _mm256_max_ps(t0_z, t1_z)));
+
+    const __m256 node_mask =
+      _mm256_and_ps(active, _mm256_cmp_ps(t_near, t_far, _CMP_LE_OQ));
+    const int node_lanes = _mm256_movemask_ps(node_mask);
+
+    if (node_lanes == 0) {
+      continue;
+    }
+
+    if (node.triangle_count == 0) {
+      // the first lane still in the box decides which child is nearer
+      const int lane = std::countr_zero(static_cast<uint32_t>(node_lanes));
+
+      const MeshBvhNode& left  = nodes[node.first];
+      const MeshBvhNode& right = nodes[node.first + 1];
+
+      const glm::vec3 center_offset =
+        (right.aabb_min + right.aabb_max) - (left.aabb_min + left.aabb_max);
+      const float direction_dot = center_offset.x * packet.direction_x[lane] +
+                                  center_offset.y * packet.direction_y[lane] +
+                                  center_offset.z * packet.direction_z[lane];
+
+      if (direction_dot < 0.f) {
+        node_stack[stack_size++] = node.first;
+        node_stack[stack_size++] = node.first + 1;
+      } else {
+        node_stack[stack_size++] = node.first + 1;
+        node_stack[stack_size++] = node.first;
+      }
+      continue;
+    }
+
+    for (uint32_t i = node.first; i < node.first + node.triangle_count; i++) {
+      const __m256 corner_x = _mm256_set1_ps(triangle_corners[i].x);
+      const __m256 corner_y = _mm256_set1_ps(triangle_corners[i].y);
+      const __m256 corner_z = _mm256_set1_ps(triangle_corners[i].z);
+      const __m256 edge1_x  = _mm256_set1_ps(triangle_edges1[i].x);
+      const __m256 edge1_y  = _mm256_set1_ps(triangle_edges1[i].y);
+      const __m256 edge1_z  = _mm256_set1_ps(triangle_edges1[i].z);
+      const __m256 edge2_x  = _mm256_set1_ps(triangle_edges2[i].x);
+      const __m256 edge2_y  = _mm256_set1_ps(triangle_edges2[i].y);
+      const __m256 edge2_z  = _mm256_set1_ps(triangle_edges2[i].z);
+
+      // p = cross(direction, edge2)
+      const __m256 p_x = multiply_subtract(
+        direction_y, edge2_z, _mm256_mul_ps(direction_z, edge2_y));
+      const __m256 p_y = multiply_subtract(
+        direction_z, edge2_x, _mm256_mul_ps(direction_x, edge2_z));
+      const __m256 p_z = multiply_subtract(
+        direction_x, edge2_y, _mm256_mul_ps(direction_y, edge2_x));
+
+      const __m256 determinant = multiply_add(
+        edge1_x,
+        p_x,
+        multiply_add(edge1_y, p_y, _mm256_mul_ps(edge1_z, p_z)));
+      const __m256 inverse_determinant = _mm256_div_ps(one, determinant);
+
+      const __m256 s_x = _mm256_sub_ps(origin_x, corner_x);
+      const __m256 s_y = _mm256_sub_ps(origin_y, corner_y);
+      const __m256 s_z = _mm256_sub_ps(origin_z, corner_z);
+
+      const __m256 u = _mm256_mul_ps(
+        multiply_add(
+          s_x, p_x, multiply_add(s_y, p_y, _mm256_mul_ps(s_z, p_z))),
+        inverse_determinant);
+
+      // q = cross(s, edge1)
+      const __m256 q_x =
+        multiply_subtract(s_y, edge1_z, _mm256_mul_ps(s_z, edge1_y));
+      const __m256 q_y =
+        multiply_subtract(s_z, edge1_x, _mm256_mul_ps(s_x, edge1_z));
+      const __m256 q_z =
+        multiply_subtract(s_x, edge1_y, _mm256_mul_ps(s_y, edge1_x));
+
+      const __m256 v = _mm256_mul_ps(
+        multiply_add(
+          direction_x,
+          q_x,
+          multiply_add(direction_y, q_y, _mm256_mul_ps(direction_z, q_z))),
+        inverse_determinant);
+      const __m256 t = _mm256_mul_ps(
+        multiply_add(
+          edge2_x,
+          q_x,
+          multiply_add(edge2_y, q_y, _mm256_mul_ps(edge2_z, q_z))),
+        inverse_determinant);
+
+      __m256 hit = _mm256_and_ps(
+        node_mask, _mm256_cmp_ps(determinant, zero, _CMP_NEQ_OQ));
+      hit = _mm256_and_ps(hit, _mm256_cmp_ps(u, zero, _CMP_GE_OQ));
+      hit = _mm256_and_ps(hit, _mm256_cmp_ps(v, zero, _CMP_GE_OQ));
+      hit = _mm256_and_ps(
+        hit, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_LE_OQ));
+      hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, t_min, _CMP_GE_OQ));
+      hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, t_max, _CMP_LE_OQ));
+
+      if (_mm256_testz_ps(hit, hit)) {
+        continue;
+      }
+
+      t_max    = _mm256_blendv_ps(t_max, t, hit);
+      hit_u    = _mm256_blendv_ps(hit_u, u, hit);
+      hit_v    = _mm256_blendv_ps(hit_v, v, hit);
+      triangle = _mm256_blendv_epi8(
+        triangle,
+        _mm256_set1_epi32(static_cast<int>(triangle_indices[i])),
+        _mm256_castps_si256(hit));
+    }
+  }
+
+  const __m256 found = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+    triangle, _mm256_set1_epi32(static_cast<int>(INVALID_INDEX))));
+
+  _mm256_storeu_ps(
+    out_hits.t,
+    _mm256_blendv_ps(
+      t_max, _mm256_set1_ps(std::numeric_limits<float>::max()), found));
+  _mm256_storeu_ps(out_hits.u, hit_u);
+  _mm256_storeu_ps(out_hits.v, hit_v);
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out_hits.triangle), triangle);
+#else
+  for (uint32_t lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+    const Ray ray = {
+      .origin    = { packet.origin_x[lane],
+                     packet.origin_y[lane],
+                     packet.origin_z[lane] },
+      .direction = { packet.direction_x[lane],
+                     packet.direction_y[lane],
+                     packet.direction_z[lane] },
+      .t_min     = packet.t_min[lane],
+      .t_max     = packet.t_max[lane],
+    };
+
+    RayHit hit;
+    intersect(ray, hit);
+
+    out_hits.t[lane]        = hit.t;
+    out_hits.u[lane]        = hit.u;
+    out_hits.v[lane]        = hit.v;
+    out_hits.triangle[lane] = hit.triangle;
+  }
+#endif
+}
+
+// closest point to point on the triangle corner, corner + edge1,
+// corner + edge2, by the voronoi regions of its corners and edges
+auto
+get_closest_point_on_triangle(const glm::vec3& point,
+                              const glm::vec3& corner,
+                              const glm::vec3& edge1,
+                              const glm::vec3& edge2) -> glm::vec3
+{
+  const glm::vec3 to_a = point - corner;
+  const float     d1   = glm::dot(edge1, to_a);
+  const float     d2   = glm::dot(edge2, to_a);
+
+  if (d1 <= 0.f && d2 <= 0.f) {
+    return corner;
+  }
+
+  const glm::vec3 to_b = to_a - edge1;
+  const float     d3   = glm::dot(edge1, to_b);
+  const float     d4   = glm::dot(edge2, to_b);
+
+  if (d3 >= 0.f && d4 <= d3) {
+    return corner + edge1;
+  }
+
+  const float vc = d1 * d4 - d3 * d2;
+
+  if (vc <= 0.f && d1 >= 0.f && d3 <= 0.f) {
+    return corner + edge1 * (d1 / (d1 - d3));
+  }
+
+  const glm::vec3 to_c = to_a - edge2;
+  const float     d5   = glm::dot(edge1, to_c);
+  const float     d6   = glm::dot(edge2, to_c);
+
+  if (d6 >= 0.f && d5 <= d6) {
+    return corner + edge2;
+  }
+
+  const float vb = d5 * d2 - d1 * d6;
+
+  if (vb <= 0.f && d2 >= 0.f && d6 <= 0.f) {
+    return corner + edge2 * (d2 / (d2 - d6));
+  }
+
+  const float va = d3 * d6 - d5 * d4;
+
+  if (va <= 0.f && d4 - d3 >= 0.f && d5 - d6 >= 0.f) {
+    const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    return corner + edge1 + (edge2 - edge1) * w;
+  }
+
+  const float denominator = 1.f / (va + vb + vc);
+
+  return corner + edge1 * (vb * denominator) + edge2 * (vc * denominator);
+}
+
+auto
+get_aabb_distance2(const MeshBvhNode& node, const glm::vec3& point) -> float
+{
+  const glm::vec3 offset = glm::max(
+    glm::max(node.aabb_min - point, point - node.aabb_max), glm::vec3{ 0.f });
+
+  return glm::dot(offset, offset);
+}
+
+auto
+MeshBvh::closest_point(const glm::vec3& point,
+                       float            max_distance,
+                       ClosestPoint&    out_closest) const -> bool
+{
+  if (nodes.empty()) {
+    return false;
+  }
+
+  float best_distance2 = max_distance * max_distance;
+  bool  found          = false;
+
+  MeshBvhStackEntry node_stack[MESH_BVH_STACK_SIZE];
+  size_t            stack_size = 0;
+
+  const float root_distance2 = get_aabb_distance2(nodes[0], point);
+
+  if (root_distance2 > best_distance2) {
+    return false;
+  }
+
+  node_stack[stack_size++] = { 0, root_distance2 };
+
+  while (stack_size > 0) {
+    const MeshBvhStackEntry entry = node_stack[--stack_size];
+
+    if (entry.distance > best_distance2) {
+      continue;
+    }
+
+    const MeshBvhNode& node = nodes[entry.node_index];
+
+    if (node.triangle_count > 0) {
+      for (uint32_t i = node.first; i < node.first + node.triangle_count;
+           i++) {
+        const glm::vec3 closest = get_closest_point_on_triangle(
+          point, triangle_corners[i], triangle_edges1[i], triangle_edges2[i]);
+        const glm::vec3 offset    = closest - point;
+        const float     distance2 = glm::dot(offset, offset);
+
+        if (distance2 <= best_distance2) {
+          out_closest    = { closest, distance2, triangle_indices[i] };
+          best_distance2 = distance2;
+          found          = true;
+        }
+      }
+      continue;
+    }
+
+    MeshBvhStackEntry near_child = {
+      node.first, get_aabb_distance2(nodes[node.first], point)
+    };
+    MeshBvhStackEntry far_child = {
+      node.first + 1, get_aabb_distance2(nodes[node.first + 1], point)
+    };
+
+    if (far_child.distance < near_child.distance) {
+      std::swap(near_child, far_child);
+    }
+
+    if (far_child.distance <= best_distance2) {
+      node_stack[stack_size++] = far_child;
+    }
+    if (near_child.distance <= best_distance2) {
+      node_stack[stack_size++] = near_child;
+    }
+  }
+
+  return found;
+}
+
+} // namespace pxd::ass
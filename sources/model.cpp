@@ -6,19 +6,30 @@
 #include "filesystem.hpp"
 #include "logger.hpp"
 
+#include "mesh_bvh.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
 #include "types.hpp"
 
 #include "meshoptimizer.h"
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+
 namespace pxd::ass {
 auto
-Model::init(std::string_view filepath, IMPORTER importer) -> bool
+Model::init(std::string_view     filepath,
+            IMPORTER             importer,
+            const ImportOptions& options) -> bool
 {
   if (!pxd::fs::exists(filepath.data())) {
     PXD_LOG_WARNING("{} is not exists", filepath);
     return false;
   }
 
+  bool imported = false;
+
   switch (importer) {
     case IMPORTER::FASTGLTF: {
       if (!filepath.ends_with(".gltf") && !filepath.ends_with(".glb")) {
@@ -27,16 +38,46 @@ Model::init(std::string_view filepath, IMPORTER importer) -> bool
         return false;
       }
       FastGltfImport fastgltf_importer;
-      return fastgltf_importer.init(filepath, meshes, nodes, parent_nodes);
+      imported = fastgltf_importer.init(
+        filepath, options, meshes, nodes, parent_nodes);
+      break;
     }
     case IMPORTER::ASSIMP: {
       AssimpImport assimp_importer;
-      return assimp_importer.init(filepath, meshes, nodes, parent_nodes);
+      imported =
+        assimp_importer.init(filepath, options, meshes, nodes, parent_nodes);
+      break;
     }
     default:
       PXD_LOG_WARNING("Invalid Importer Type");
       return false;
   }
+
+  if (!imported) {
+    return false;
+  }
+
+  mesh_indices.reserve(meshes.size());
+  node_indices.reserve(nodes.size());
+
+  for (uint32_t i = 0; i < meshes.size(); i++) {
+    mesh_indices.try_emplace(meshes[i].name, i);
+  }
+
+  for (uint32_t i = 0; i < nodes.size(); i++) {
+    node_indices.try_emplace(nodes[i].name, i);
+  }
+
+  // after the name tables so names of dropped meshes are remapped as well
+  if (options.deduplicate_meshes) {
+    deduplicate_meshes(options.thread_count);
+  }
+
+  build_node_order();
+  set_transform(glm::mat4{ 1.f });
+  build_scene_bvh();
+
+  return true;
 }
 
 auto
@@ -45,91 +86,872 @@ Model::destroy() -> bool
   parent_nodes.clear();
   meshes.clear();
   nodes.clear();
+  mesh_indices.clear();
+  node_indices.clear();
   image_files.clear();
+  node_order.clear();
+  node_positions.clear();
+  subtree_ends.clear();
+  dirty_nodes.clear();
+  scene_bvh.clear();
+  refit_all = false;
+  refit_nodes.clear();
+  refit_marks.clear();
+
+  return true;
+}
+
+// Order dependent 64-bit mix with a fixed seed, so the same input hashes the
+// same in every process and run. Floats hash by their bits with both zeros
+// folded together, so values that compare equal always hash equal.
+struct StableHasher
+{
+  uint64_t hash = 0x9e3779b97f4a7c15ull;
+
+  void add(uint64_t word)
+  {
+    hash = std::rotl((hash ^ word) * 0xff51afd7ed558ccdull, 31);
+  }
+  void add_float(float value)
+  {
+    add(value == 0.f ? 0u : std::bit_cast<uint32_t>(value));
+  }
+  void add_string(std::string_view text)
+  {
+    add(text.size());
+
+    for (char c : text) {
+      add(static_cast<uint8_t>(c));
+    }
+  }
+
+  auto finish() const -> uint64_t
+  {
+    uint64_t result = hash;
+    result ^= result >> 33;
+    result *= 0xc4ceb9fe1a85ec53ull;
+    result ^= result >> 33;
+
+    return result;
+  }
+};
+
+void
+add_mesh_geometry(StableHasher& hasher, const Mesh& mesh)
+{
+  hasher.add(mesh.indices.size());
+  hasher.add(mesh.positions.size());
+  hasher.add(mesh.normals.size());
+  hasher.add(mesh.uvs.size());
+  hasher.add(mesh.submeshes.size());
+
+  for (uint32_t index : mesh.indices) {
+    hasher.add(index);
+  }
+  for (const glm::vec3& position : mesh.positions) {
+    hasher.add_float(position.x);
+    hasher.add_float(position.y);
+    hasher.add_float(position.z);
+  }
+  for (const glm::vec3& normal : mesh.normals) {
+    hasher.add_float(normal.x);
+    hasher.add_float(normal.y);
+    hasher.add_float(normal.z);
+  }
+  for (const glm::vec2& uv : mesh.uvs) {
+    hasher.add_float(uv.x);
+    hasher.add_float(uv.y);
+  }
+  for (const SubMesh& submesh : mesh.submeshes) {
+    hasher.add(submesh.index_offset);
+    hasher.add(submesh.index_count);
+    hasher.add(submesh.vertex_offset);
+    hasher.add(submesh.vertex_count);
+    hasher.add(submesh.material_index);
+  }
+}
+
+// Hash of the geometry streams and submesh ranges of a mesh, only used to find
+// candidates for mesh_geometry_equal, so meshes that compare equal always
+// hash equal.
+auto
+hash_mesh_geometry(const Mesh& mesh) -> uint64_t
+{
+  StableHasher hasher;
+  add_mesh_geometry(hasher, mesh);
+
+  return hasher.finish();
+}
+
+auto
+mesh_geometry_equal(const Mesh& a, const Mesh& b) -> bool
+{
+  if (a.indices != b.indices || a.positions != b.positions ||
+      a.normals != b.normals || a.uvs != b.uvs ||
+      a.submeshes.size() != b.submeshes.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.submeshes.size(); i++) {
+    const SubMesh& submesh_a = a.submeshes[i];
+    const SubMesh& submesh_b = b.submeshes[i];
+
+    if (submesh_a.index_offset != submesh_b.index_offset ||
+        submesh_a.index_count != submesh_b.index_count ||
+        submesh_a.vertex_offset != submesh_b.vertex_offset ||
+        submesh_a.vertex_count != submesh_b.vertex_count ||
+        submesh_a.material_index != submesh_b.material_index) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void
+Model::deduplicate_meshes(uint32_t thread_count)
+{
+  std::vector<uint64_t> hashes(meshes.size());
+
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    hashes[i] = hash_mesh_geometry(meshes[i]);
+  });
+
+  // The first mesh of every distinct geometry is kept and compacted to the
+  // front in source order. Kept meshes are grouped by hash, so a collision
+  // only costs an extra comparison.
+  absl::flat_hash_map<uint64_t, std::vector<uint32_t>> kept_meshes;
+  std::vector<uint32_t>                                remap(meshes.size());
+  uint32_t                                             kept_count = 0;
+
+  for (uint32_t i = 0; i < meshes.size(); i++) {
+    std::vector<uint32_t>& candidates = kept_meshes[hashes[i]];
+
+    remap[i] = INVALID_INDEX;
+
+    for (uint32_t kept_index : candidates) {
+      if (mesh_geometry_equal(meshes[kept_index], meshes[i])) {
+        remap[i] = kept_index;
+        break;
+      }
+    }
+
+    if (remap[i] != INVALID_INDEX) {
+      continue;
+    }
+
+    remap[i] = kept_count++;
+    candidates.push_back(remap[i]);
+
+    if (remap[i] != i) {
+      meshes[remap[i]] = std::move(meshes[i]);
+    }
+  }
+
+  if (kept_count == meshes.size()) {
+    return;
+  }
+
+  meshes.resize(kept_count);
+
+  for (MeshNode& node : nodes) {
+    for (uint32_t& mesh_index : node.meshes) {
+      if (mesh_index < remap.size()) {
+        mesh_index = remap[mesh_index];
+      }
+    }
+  }
+
+  for (auto& [name, mesh_index] : mesh_indices) {
+    mesh_index = remap[mesh_index];
+  }
+}
+
+// reorders every vertex stream of a mesh with a meshoptimizer remap table,
+// each stream is remapped in place and shrunk to vertex_count
+void
+remap_mesh_streams(Mesh& mesh, const unsigned int* remap, size_t vertex_count)
+{
+  size_t total_vertices = mesh.positions.size();
+
+  meshopt_remapVertexBuffer(mesh.positions.data(),
+                            mesh.positions.data(),
+                            total_vertices,
+                            sizeof(glm::vec3),
+                            remap);
+  meshopt_remapVertexBuffer(mesh.normals.data(),
+                            mesh.normals.data(),
+                            total_vertices,
+                            sizeof(glm::vec3),
+                            remap);
+  meshopt_remapVertexBuffer(
+    mesh.uvs.data(), mesh.uvs.data(), total_vertices, sizeof(glm::vec2), remap);
+
+  mesh.positions.resize(vertex_count);
+  mesh.normals.resize(vertex_count);
+  mesh.uvs.resize(vertex_count);
+}
+
+// deduplicates the vertices of a mesh by comparing all streams together,
+// without building an interleaved copy of the vertices
+void
+remap_mesh_vertices(Mesh& mesh)
+{
+  size_t index_count    = mesh.indices.size();
+  size_t total_vertices = mesh.positions.size();
+
+  // only the xyz components are compared, so the padding of an aligned
+  // glm::vec3 never splits identical vertices
+  const meshopt_Stream streams[] = {
+    { mesh.positions.data(), 3 * sizeof(float), sizeof(glm::vec3) },
+    { mesh.normals.data(), 3 * sizeof(float), sizeof(glm::vec3) },
+    { mesh.uvs.data(), 2 * sizeof(float), sizeof(glm::vec2) },
+  };
+
+  std::vector<unsigned int> remap(total_vertices);
+
+  size_t vertex_count = meshopt_generateVertexRemapMulti(&remap[0],
+                                                         mesh.indices.data(),
+                                                         index_count,
+                                                         total_vertices,
+                                                         streams,
+                                                         std::size(streams));
+
+  meshopt_remapIndexBuffer(
+    mesh.indices.data(), mesh.indices.data(), index_count, &remap[0]);
+  remap_mesh_streams(mesh, &remap[0], vertex_count);
+}
+
+void
+optimize_indices(uint32_t*        indices,
+                 size_t           index_count,
+                 const glm::vec3* positions,
+                 size_t           vertex_count)
+{
+  meshopt_optimizeVertexCache(indices, indices, index_count, vertex_count);
+  meshopt_optimizeOverdraw(indices,
+                           indices,
+                           index_count,
+                           &positions[0].x,
+                           vertex_count,
+                           sizeof(glm::vec3),
+                           1.05f);
+}
+
+// optimizes one chunk of a large mesh's indices. The chunk is rebased onto
+// the sorted list of vertices it references first, so meshoptimizer only
+// sees the chunk's own vertices instead of the whole vertex count.
+void
+optimize_index_chunk(uint32_t* indices, size_t index_count, const Mesh& mesh)
+{
+  std::vector<uint32_t> chunk_vertices(indices, indices + index_count);
+  std::sort(chunk_vertices.begin(), chunk_vertices.end());
+  chunk_vertices.erase(
+    std::unique(chunk_vertices.begin(), chunk_vertices.end()),
+    chunk_vertices.end());
+
+  std::vector<uint32_t>  local_indices(index_count);
+  std::vector<glm::vec3> local_positions(chunk_vertices.size());
+
+  for (size_t i = 0; i < index_count; i++) {
+    local_indices[i] = static_cast<uint32_t>(
+      std::lower_bound(
+        chunk_vertices.begin(), chunk_vertices.end(), indices[i]) -
+      chunk_vertices.begin());
+  }
+
+  for (size_t v = 0; v < chunk_vertices.size(); v++) {
+    local_positions[v] = mesh.positions[chunk_vertices[v]];
+  }
+
+  optimize_indices(local_indices.data(),
+                   index_count,
+                   local_positions.data(),
+                   local_positions.size());
+
+  for (size_t i = 0; i < index_count; i++) {
+    indices[i] = chunk_vertices[local_indices[i]];
+  }
+}
+
+// orders the vertices by first use in the final index buffer
+void
+finalize_mesh_vertices(Mesh& mesh)
+{
+  size_t index_count    = mesh.indices.size();
+  size_t total_vertices = mesh.positions.size();
+
+  std::vector<unsigned int> remap(total_vertices);
+
+  size_t vertex_count = meshopt_optimizeVertexFetchRemap(
+    &remap[0], mesh.indices.data(), index_count, total_vertices);
+
+  meshopt_remapIndexBuffer(
+    mesh.indices.data(), mesh.indices.data(), index_count, &remap[0]);
+  remap_mesh_streams(mesh, &remap[0], vertex_count);
+}
+
+// copies every submesh of mesh into its own mesh with local indices and
+// releases the streams of mesh, fails when a submesh references vertices
+// outside of its vertex range
+auto
+split_submeshes(Mesh& mesh, std::vector<Mesh>& parts) -> bool
+{
+  parts.resize(mesh.submeshes.size());
+
+  for (size_t i = 0; i < mesh.submeshes.size(); i++) {
+    const SubMesh& submesh = mesh.submeshes[i];
+    Mesh&          part    = parts[i];
+
+    const auto first_index  = mesh.indices.begin() + submesh.index_offset;
+    const auto first_vertex = submesh.vertex_offset;
+    const auto last_vertex  = first_vertex + submesh.vertex_count;
+
+    part.indices.assign(first_index, first_index + submesh.index_count);
+
+    for (uint32_t& index : part.indices) {
+      if (index < first_vertex || index >= last_vertex) {
+        parts.clear();
+        return false;
+      }
+
+      index -= first_vertex;
+    }
+
+    part.positions.assign(mesh.positions.begin() + first_vertex,
+                          mesh.positions.begin() + last_vertex);
+    part.normals.assign(mesh.normals.begin() + first_vertex,
+                        mesh.normals.begin() + last_vertex);
+    part.uvs.assign(mesh.uvs.begin() + first_vertex,
+                    mesh.uvs.begin() + last_vertex);
+  }
+
+  mesh.indices   = {};
+  mesh.positions = {};
+  mesh.normals   = {};
+  mesh.uvs       = {};
 
   return true;
 }
 
+// concatenates optimized parts back into mesh in submesh order and updates
+// the submesh ranges
 void
-Model::optimize_meshes()
+merge_submeshes(Mesh& mesh, std::vector<Mesh>& parts)
 {
-  for (auto& [mesh_name, mesh] : meshes) {
-    size_t              index_count    = mesh.indices.size();
-    size_t              total_vertices = mesh.positions.size();
-    std::vector<Vertex> temp_vertices  = mesh.get_AoS();
+  size_t index_count  = 0;
+  size_t vertex_count = 0;
+
+  for (const Mesh& part : parts) {
+    index_count += part.indices.size();
+    vertex_count += part.positions.size();
+  }
+
+  mesh.indices.reserve(index_count);
+  mesh.positions.reserve(vertex_count);
+  mesh.normals.reserve(vertex_count);
+  mesh.uvs.reserve(vertex_count);
+
+  for (size_t i = 0; i < parts.size(); i++) {
+    SubMesh& submesh = mesh.submeshes[i];
+    Mesh&    part    = parts[i];
+
+    submesh.index_offset  = static_cast<uint32_t>(mesh.indices.size());
+    submesh.index_count   = static_cast<uint32_t>(part.indices.size());
+    submesh.vertex_offset = static_cast<uint32_t>(mesh.positions.size());
+    submesh.vertex_count  = static_cast<uint32_t>(part.positions.size());
+
+    for (uint32_t index : part.indices) {
+      mesh.indices.push_back(index + submesh.vertex_offset);
+    }
+
+    mesh.positions.insert(
+      mesh.positions.end(), part.positions.begin(), part.positions.end());
+    mesh.normals.insert(
+      mesh.normals.end(), part.normals.begin(), part.normals.end());
+    mesh.uvs.insert(mesh.uvs.end(), part.uvs.begin(), part.uvs.end());
+  }
+
+  parts = {};
+}
+
+void
+Model::optimize_meshes(uint32_t thread_count)
+{
+  // Meshes with several submeshes are optimized one submesh at a time, so
+  // neither triangles nor vertices move out of their submesh range. Every
+  // mesh or split submesh becomes one target.
+  std::vector<std::vector<Mesh>> split_meshes(meshes.size());
+  std::vector<uint8_t>           skipped_meshes(meshes.size(), 0);
+
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    Mesh& mesh = meshes[i];
+
+    if (mesh.indices.empty()) {
+      skipped_meshes[i] = 1;
+      return;
+    }
+
+    mesh.invalidate_connectivity();
+    mesh.bvh.reset();
+    mesh.triangles.clear();
+    mesh.quads.clear();
+    mesh.lods.clear();
+    mesh.meshlets.clear();
+    mesh.meshlet_vertices.clear();
+    mesh.meshlet_triangles.clear();
+    mesh.meshlet_offsets.clear();
+
+    if (mesh.submeshes.size() > 1 &&
+        !split_submeshes(mesh, split_meshes[i])) {
+      PXD_LOG_WARNING("{} has a submesh indexing outside of its vertex range, "
+                      "it is not optimized",
+                      mesh.name);
+      skipped_meshes[i] = 1;
+    }
+  });
+
+  std::vector<Mesh*> targets;
+
+  for (size_t i = 0; i < meshes.size(); i++) {
+    if (skipped_meshes[i]) {
+      continue;
+    }
+
+    if (split_meshes[i].empty()) {
+      targets.push_back(&meshes[i]);
+      continue;
+    }
+
+    for (Mesh& part : split_meshes[i]) {
+      if (!part.indices.empty()) {
+        targets.push_back(&part);
+      }
+    }
+  }
+
+  // targets above OPTIMIZE_CHUNK_INDEX_COUNT are only remapped in the first
+  // pass, the rest are optimized end to end
+  parallel_for(targets.size(), thread_count, [&](size_t i) {
+    Mesh& target = *targets[i];
 
-    std::vector<unsigned int> remap(index_count);
+    remap_mesh_vertices(target);
 
-    size_t vertex_count = meshopt_generateVertexRemap(&remap[0],
-                                                      mesh.indices.data(),
-                                                      index_count,
-                                                      &temp_vertices[0],
-                                                      total_vertices,
-                                                      sizeof(Vertex));
+    if (target.indices.size() > OPTIMIZE_CHUNK_INDEX_COUNT) {
+      return;
+    }
+
+    optimize_indices(target.indices.data(),
+                     target.indices.size(),
+                     target.positions.data(),
+                     target.positions.size());
+    finalize_mesh_vertices(target);
+  });
+
+  // the vertex cache and overdraw passes of large targets run on independent
+  // index chunks, so one huge mesh is spread over the pool instead of
+  // becoming a single long task. Its vertex remap before and vertex fetch
+  // pass after still run as one task per target.
+  struct IndexChunk
+  {
+    size_t target_index;
+    size_t first_index;
+    size_t index_count;
+  };
 
-    std::vector<Vertex> target_vertices(vertex_count);
+  std::vector<size_t>     large_targets;
+  std::vector<IndexChunk> chunks;
+
+  for (size_t i = 0; i < targets.size(); i++) {
+    const size_t index_count = targets[i]->indices.size();
+
+    if (index_count <= OPTIMIZE_CHUNK_INDEX_COUNT) {
+      continue;
+    }
 
-    meshopt_remapIndexBuffer(
-      mesh.indices.data(), mesh.indices.data(), index_count, &remap[0]);
-    meshopt_remapVertexBuffer(target_vertices.data(),
-                              &temp_vertices[0],
-                              total_vertices,
-                              sizeof(Vertex),
-                              &remap[0]);
-    meshopt_optimizeVertexCache(
-      mesh.indices.data(), mesh.indices.data(), index_count, vertex_count);
-    meshopt_optimizeOverdraw(mesh.indices.data(),
-                             mesh.indices.data(),
-                             index_count,
-                             &target_vertices[0].pos.x,
-                             vertex_count,
-                             sizeof(Vertex),
-                             1.05f);
-    meshopt_optimizeVertexFetch(target_vertices.data(),
-                                mesh.indices.data(),
-                                index_count,
-                                target_vertices.data(),
-                                vertex_count,
-                                sizeof(Vertex));
+    large_targets.push_back(i);
 
-    mesh.from_AoS(target_vertices);
+    for (size_t first = 0; first < index_count;
+         first += OPTIMIZE_CHUNK_INDEX_COUNT) {
+      const size_t count =
+        std::min(OPTIMIZE_CHUNK_INDEX_COUNT, index_count - first);
+      chunks.push_back({ i, first, count });
+    }
   }
+
+  parallel_for(chunks.size(), thread_count, [&](size_t i) {
+    const IndexChunk& chunk  = chunks[i];
+    Mesh&             target = *targets[chunk.target_index];
+
+    optimize_index_chunk(
+      target.indices.data() + chunk.first_index, chunk.index_count, target);
+  });
+
+  parallel_for(large_targets.size(), thread_count, [&](size_t i) {
+    finalize_mesh_vertices(*targets[large_targets[i]]);
+  });
+
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    Mesh& mesh = meshes[i];
+
+    if (!split_meshes[i].empty()) {
+      merge_submeshes(mesh, split_meshes[i]);
+    } else if (!skipped_meshes[i] && mesh.submeshes.size() == 1) {
+      mesh.submeshes[0].vertex_offset = 0;
+      mesh.submeshes[0].vertex_count =
+        static_cast<uint32_t>(mesh.positions.size());
+    }
+  });
+}
+
+void
+Model::generate_lods(std::span<const LodTarget> targets, uint32_t thread_count)
+{
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    meshes[i].generate_lods(targets);
+  });
+}
+
+void
+Model::build_meshlets(uint32_t thread_count,
+                      size_t   max_vertices,
+                      size_t   max_triangles)
+{
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    meshes[i].build_meshlets(max_vertices, max_triangles);
+  });
+}
+
+void
+Model::build_mesh_bvhs(uint32_t thread_count)
+{
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    if (meshes[i].indices.size() / 3 <= MESH_BVH_TASK_TRIANGLES) {
+      meshes[i].build_bvh();
+    }
+  });
+
+  for (Mesh& mesh : meshes) {
+    if (mesh.indices.size() / 3 > MESH_BVH_TASK_TRIANGLES) {
+      mesh.build_bvh(thread_count);
+    }
+  }
+}
+
+auto
+Model::compress_meshes(uint32_t thread_count) -> bool
+{
+  std::atomic<bool> compressed = true;
+
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    if (!meshes[i].compress()) {
+      PXD_LOG_WARNING("{} could not be compressed", meshes[i].name);
+      compressed = false;
+    }
+  });
+
+  return compressed;
+}
+
+auto
+Model::decompress_meshes(uint32_t thread_count) -> bool
+{
+  std::atomic<bool> decompressed = true;
+
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    if (!meshes[i].decompress()) {
+      PXD_LOG_WARNING("{} could not be decompressed", meshes[i].name);
+      decompressed = false;
+    }
+  });
+
+  return decompressed;
 }
 
 auto
-Model::get_mesh_w_name(const std::string& mesh_name, Mesh& mesh) -> bool
+Model::get_mesh_w_name(std::string_view mesh_name, Mesh& mesh) -> bool
 {
-  if (!meshes.contains(mesh_name)) {
+  const Mesh* found_mesh = find_mesh(mesh_name);
+
+  if (found_mesh == nullptr) {
     return false;
   }
 
-  mesh = meshes[mesh_name];
+  mesh = *found_mesh;
   return true;
 }
 
 auto
-Model::check_mesh_w_name(const std::string& mesh_name) -> bool
+Model::check_mesh_w_name(std::string_view mesh_name) const -> bool
 {
-  return meshes.contains(mesh_name);
+  return mesh_indices.contains(mesh_name);
+}
+
+auto
+Model::find_mesh(std::string_view mesh_name) -> Mesh*
+{
+  uint32_t mesh_index = find_mesh_index(mesh_name);
+
+  return mesh_index == INVALID_INDEX ? nullptr : &meshes[mesh_index];
+}
+
+auto
+Model::find_mesh(std::string_view mesh_name) const -> const Mesh*
+{
+  uint32_t mesh_index = find_mesh_index(mesh_name);
+
+  return mesh_index == INVALID_INDEX ? nullptr : &meshes[mesh_index];
+}
+
+auto
+Model::find_mesh_index(std::string_view mesh_name) const -> uint32_t
+{
+  auto it = mesh_indices.find(mesh_name);
+
+  return it == mesh_indices.end() ? INVALID_INDEX : it->second;
+}
+
+void
+Model::find_mesh_indices(std::span<const std::string_view> mesh_names,
+                         std::span<uint32_t>               out_indices) const
+{
+  for (size_t i = 0; i < mesh_names.size(); i++) {
+    out_indices[i] = find_mesh_index(mesh_names[i]);
+  }
 }
 
 void
 Model::set_transform(const glm::mat4x4& new_transform)
 {
-  for (auto&& parent_node : parent_nodes) {
-    parent_node->reassign_transforms(new_transform);
+  model_transform = new_transform;
+  dirty_nodes.clear();
+
+  propagate_transforms(0, static_cast<uint32_t>(node_order.size()));
+
+  for (uint32_t node_index : refit_nodes) {
+    refit_marks[node_index] = 0;
+  }
+
+  refit_nodes.clear();
+  refit_all = true;
+}
+
+void
+Model::set_local_transform(uint32_t node_index, const glm::mat4& transform)
+{
+  nodes[node_index].local_transform = transform;
+  dirty_nodes.push_back(node_index);
+}
+
+void
+Model::update_transforms()
+{
+  if (dirty_nodes.empty()) {
+    return;
+  }
+
+  std::vector<uint32_t> dirty_positions;
+  dirty_positions.reserve(dirty_nodes.size());
+
+  for (uint32_t node_index : dirty_nodes) {
+    if (node_positions[node_index] != INVALID_INDEX) {
+      dirty_positions.push_back(node_positions[node_index]);
+    }
+  }
+
+  std::sort(dirty_positions.begin(), dirty_positions.end());
+
+  // subtrees are contiguous in node_order, a dirty node inside an already
+  // updated range is skipped since its ancestor covered it
+  uint32_t updated_end = 0;
+
+  for (uint32_t position : dirty_positions) {
+    if (position < updated_end) {
+      continue;
+    }
+
+    updated_end = subtree_ends[position];
+    propagate_transforms(position, updated_end);
+
+    // refit_marks is empty until the scene bvh has been built
+    if (refit_all || refit_marks.empty()) {
+      continue;
+    }
+
+    for (uint32_t p = position; p < updated_end; p++) {
+      if (refit_marks[node_order[p]] == 0) {
+        refit_marks[node_order[p]] = 1;
+        refit_nodes.push_back(node_order[p]);
+      }
+    }
+  }
+
+  dirty_nodes.clear();
+}
+
+void
+Model::build_scene_bvh()
+{
+  scene_bvh.build(nodes, meshes, node_positions);
+
+  refit_all = false;
+  refit_nodes.clear();
+  refit_marks.assign(nodes.size(), 0);
+}
+
+void
+Model::refit_scene_bvh()
+{
+  if (refit_all) {
+    scene_bvh.refit(nodes, meshes);
+  } else if (!refit_nodes.empty()) {
+    scene_bvh.refit(nodes, meshes, refit_nodes);
+  }
+
+  for (uint32_t node_index : refit_nodes) {
+    refit_marks[node_index] = 0;
+  }
+
+  refit_all = false;
+  refit_nodes.clear();
+}
+
+void
+Model::query_frustum(const Frustum&             frustum,
+                     std::vector<MeshInstance>& out_instances)
+{
+  refit_scene_bvh();
+  scene_bvh.query_frustum(frustum, out_instances);
+}
+
+void
+Model::cull_instances(const Frustum&         frustum,
+                      std::vector<uint32_t>& out_visible)
+{
+  refit_scene_bvh();
+  scene_bvh.cull(frustum, out_visible);
+}
+
+auto
+Model::get_instances() const -> std::span<const MeshInstance>
+{
+  return scene_bvh.get_instances();
+}
+
+void
+Model::propagate_transforms(uint32_t begin, uint32_t end)
+{
+  static_assert(sizeof(glm::mat4) == 16 * sizeof(float));
+
+  // parents come first in node_order, so every parent world transform is
+  // final by the time its children read it. A root listed in parent_nodes is
+  // treated as one even if it names a parent, that parent does not come
+  // before it.
+  for (uint32_t position = begin; position < end; position++) {
+    MeshNode& node = nodes[node_order[position]];
+
+    const bool has_parent =
+      node.parent != INVALID_INDEX && node_positions[node.parent] < position;
+    const glm::mat4& parent_matrix =
+      has_parent ? nodes[node.parent].world_transform : model_transform;
+
+    multiply_mat4(&parent_matrix[0][0],
+                  &node.local_transform[0][0],
+                  &node.world_transform[0][0]);
+  }
+}
+
+void
+Model::build_node_order()
+{
+  node_order.clear();
+  node_order.reserve(nodes.size());
+
+  std::vector<uint32_t> node_stack(parent_nodes.rbegin(), parent_nodes.rend());
+
+  while (!node_stack.empty()) {
+    uint32_t node_index = node_stack.back();
+    node_stack.pop_back();
+
+    node_order.push_back(node_index);
+
+    const std::vector<uint32_t>& children = nodes[node_index].children;
+    node_stack.insert(node_stack.end(), children.rbegin(), children.rend());
+  }
+
+  // walking the pre-order backwards visits children before their parents,
+  // which is enough to sum up subtree sizes in one pass
+  std::vector<uint32_t> subtree_sizes(nodes.size(), 1);
+
+  node_positions.assign(nodes.size(), INVALID_INDEX);
+  subtree_ends.resize(node_order.size());
+
+  for (uint32_t position = node_order.size(); position-- > 0;) {
+    uint32_t node_index = node_order[position];
+    uint32_t parent     = nodes[node_index].parent;
+
+    if (parent != INVALID_INDEX) {
+      subtree_sizes[parent] += subtree_sizes[node_index];
+    }
+
+    node_positions[node_index] = position;
+    subtree_ends[position]     = position + subtree_sizes[node_index];
   }
 }
 
-std::vector<Mesh>
-Model::get_meshes()
+auto
+Model::get_meshes() -> std::span<Mesh>
 {
-  std::vector<Mesh> mesh_vec(meshes.size());
+  return meshes;
+}
+
+auto
+Model::get_meshes() const -> std::span<const Mesh>
+{
+  return meshes;
+}
+
+auto
+Model::get_content_hash() const -> uint64_t
+{
+  StableHasher hasher;
+
+  hasher.add(meshes.size());
+
+  for (const Mesh& mesh : meshes) {
+    hasher.add_string(mesh.name);
+    add_mesh_geometry(hasher, mesh);
+  }
+
+  hasher.add(nodes.size());
+
+  for (const MeshNode& node : nodes) {
+    hasher.add_string(node.name);
+    hasher.add(node.parent);
+
+    hasher.add(node.children.size());
+    for (uint32_t child : node.children) {
+      hasher.add(child);
+    }
+
+    hasher.add(node.meshes.size());
+    for (uint32_t mesh_index : node.meshes) {
+      hasher.add(mesh_index);
+    }
+
+    for (int column = 0; column < 4; column++) {
+      for (int row = 0; row < 4; row++) {
+        hasher.add_float(node.local_transform[column][row]);
+      }
+    }
+  }
+
+  hasher.add(parent_nodes.size());
 
-  for (auto&& [mesh_name, mesh] : meshes) {
-    mesh_vec.push_back(mesh);
+  for (uint32_t node_index : parent_nodes) {
+    hasher.add(node_index);
   }
 
-  return mesh_vec;
+  return hasher.finish();
 }
 }
\ No newline at end of file
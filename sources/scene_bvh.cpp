@@ -0,0 +1,357 @@
+#include "scene_bvh.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace pxd::ass {
+
+void
+SceneBvh::update_instance_bounds(const std::vector<MeshNode>& nodes,
+                                 const std::vector<Mesh>&     meshes,
+                                 uint32_t                     slot)
+{
+  const MeshInstance& instance = instances[slot];
+
+  world_bounds.update(slot,
+                      nodes[instance.node_index].world_transform,
+                      meshes[instance.mesh_index].bounds);
+}
+
+void
+SceneBvh::build(const std::vector<MeshNode>& nodes,
+                const std::vector<Mesh>&     meshes,
+                std::span<const uint32_t>    node_positions)
+{
+  clear();
+
+  std::vector<MeshInstance> unordered_instances;
+
+  for (uint32_t n = 0; n < nodes.size(); n++) {
+    if (node_positions[n] == INVALID_INDEX) {
+      continue;
+    }
+
+    for (uint32_t mesh_index : nodes[n].meshes) {
+      if (mesh_index < meshes.size()) {
+        unordered_instances.push_back({ n, mesh_index });
+      }
+    }
+  }
+
+  if (unordered_instances.empty()) {
+    return;
+  }
+
+  const uint32_t instance_count =
+    static_cast<uint32_t>(unordered_instances.size());
+
+  instances = unordered_instances;
+  world_bounds.resize(instance_count);
+
+  for (uint32_t slot = 0; slot < instance_count; slot++) {
+    update_instance_bounds(nodes, meshes, slot);
+  }
+
+  std::vector<glm::vec3> centroids(instance_count);
+
+  for (uint32_t slot = 0; slot < instance_count; slot++) {
+    centroids[slot] =
+      (world_bounds.get_aabb_min(slot) + world_bounds.get_aabb_max(slot)) *
+      0.5f;
+  }
+
+  // order[i] is the unordered instance placed at leaf order slot i, ranges of
+  // it are partitioned in place as nodes are split
+  std::vector<uint32_t> order(instance_count);
+  std::iota(order.begin(), order.end(), 0);
+
+  bvh_nodes.reserve(2 * instance_count / SCENE_BVH_LEAF_SIZE + 1);
+  bvh_nodes.push_back({ .first_instance = 0,
+                        .instance_count = instance_count,
+                        .left_child     = 0,
+                        .parent         = INVALID_INDEX });
+
+  // children are always appended after their parent, so a reverse walk over
+  // bvh_nodes visits children first
+  std::vector<uint32_t> node_stack = { 0 };
+
+  while (!node_stack.empty()) {
+    const uint32_t node_index = node_stack.back();
+    node_stack.pop_back();
+
+    const uint32_t first = bvh_nodes[node_index].first_instance;
+    const uint32_t count = bvh_nodes[node_index].instance_count;
+
+    if (count <= SCENE_BVH_LEAF_SIZE) {
+      continue;
+    }
+
+    glm::vec3 centroid_min = centroids[order[first]];
+    glm::vec3 centroid_max = centroid_min;
+
+    for (uint32_t i = first; i < first + count; i++) {
+      centroid_min = glm::min(centroid_min, centroids[order[i]]);
+      centroid_max = glm::max(centroid_max, centroids[order[i]]);
+    }
+
+    const glm::vec3 extent = centroid_max - centroid_min;
+
+    int axis = 0;
+    if (extent.y > extent[axis]) {
+      axis = 1;
+    }
+    if (extent.z > extent[axis]) {
+      axis = 2;
+    }
+
+    // median split along the widest centroid axis
+    const uint32_t half = count / 2;
+
+    std::nth_element(order.begin() + first,
+                     order.begin() + first + half,
+                     order.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) {
+                       return centroids[a][axis] < centroids[b][axis];
+                     });
+
+    const uint32_t left_child = static_cast<uint32_t>(bvh_nodes.size());
+
+    bvh_nodes[node_index].left_child = left_child;
+
+    bvh_nodes.push_back({ .first_instance = first,
+                          .instance_count = half,
+                          .left_child     = 0,
+                          .parent         = node_index });
+    bvh_nodes.push_back({ .first_instance = first + half,
+                          .instance_count = count - half,
+                          .left_child     = 0,
+                          .parent         = node_index });
+
+    node_stack.push_back(left_child + 1);
+    node_stack.push_back(left_child);
+  }
+
+  for (uint32_t slot = 0; slot < instance_count; slot++) {
+    instances[slot] = unordered_instances[order[slot]];
+  }
+
+  instance_leaves.resize(instance_count);
+
+  for (uint32_t i = 0; i < bvh_nodes.size(); i++) {
+    const SceneBvhNode& bvh_node = bvh_nodes[i];
+
+    if (bvh_node.left_child != 0) {
+      continue;
+    }
+
+    for (uint32_t slot = bvh_node.first_instance;
+         slot < bvh_node.first_instance + bvh_node.instance_count;
+         slot++) {
+      instance_leaves[slot] = i;
+    }
+  }
+
+  // scene node -> slots, counted then filled like a CSR matrix
+  node_slot_offsets.assign(nodes.size() + 1, 0);
+
+  for (const MeshInstance& instance : instances) {
+    node_slot_offsets[instance.node_index + 1]++;
+  }
+
+  std::partial_sum(node_slot_offsets.begin(),
+                   node_slot_offsets.end(),
+                   node_slot_offsets.begin());
+
+  std::vector<uint32_t> fill = node_slot_offsets;
+  node_slots.resize(instance_count);
+
+  for (uint32_t slot = 0; slot < instance_count; slot++) {
+    node_slots[fill[instances[slot].node_index]++] = slot;
+  }
+
+  refit(nodes, meshes);
+}
+
+void
+SceneBvh::clear()
+{
+  bvh_nodes.clear();
+  instances.clear();
+  world_bounds.clear();
+  instance_leaves.clear();
+  node_slot_offsets.clear();
+  node_slots.clear();
+  refit_marks.clear();
+}
+
+void
+SceneBvh::refit(const std::vector<MeshNode>& nodes,
+                const std::vector<Mesh>&     meshes)
+{
+  for (uint32_t slot = 0; slot < instances.size(); slot++) {
+    update_instance_bounds(nodes, meshes, slot);
+  }
+
+  refit_marks.assign(bvh_nodes.size(), 1);
+  refit(nodes, meshes, {});
+}
+
+void
+SceneBvh::refit(const std::vector<MeshNode>& nodes,
+                const std::vector<Mesh>&     meshes,
+                std::span<const uint32_t>    changed_nodes)
+{
+  if (bvh_nodes.empty()) {
+    return;
+  }
+
+  refit_marks.resize(bvh_nodes.size(), 0);
+
+  // every touched leaf marks its ancestors, a walk stops at the first node
+  // some other leaf already marked
+  for (uint32_t node_index : changed_nodes) {
+    if (node_index + 1 >= node_slot_offsets.size()) {
+      continue;
+    }
+
+    for (uint32_t i = node_slot_offsets[node_index];
+         i < node_slot_offsets[node_index + 1];
+         i++) {
+      const uint32_t slot = node_slots[i];
+
+      update_instance_bounds(nodes, meshes, slot);
+
+      for (uint32_t bvh_index = instance_leaves[slot];
+           bvh_index != INVALID_INDEX && !refit_marks[bvh_index];
+           bvh_index = bvh_nodes[bvh_index].parent) {
+        refit_marks[bvh_index] = 1;
+      }
+    }
+  }
+
+  for (uint32_t i = static_cast<uint32_t>(bvh_nodes.size()); i-- > 0;) {
+    if (!refit_marks[i]) {
+      continue;
+    }
+
+    SceneBvhNode& bvh_node = bvh_nodes[i];
+    refit_marks[i]         = 0;
+
+    if (bvh_node.left_child != 0) {
+      const SceneBvhNode& left  = bvh_nodes[bvh_node.left_child];
+      const SceneBvhNode& right = bvh_nodes[bvh_node.left_child + 1];
+
+      bvh_node.aabb_min = glm::min(left.aabb_min, right.aabb_min);
+      bvh_node.aabb_max = glm::max(left.aabb_max, right.aabb_max);
+      continue;
+    }
+
+    const uint32_t first = bvh_node.first_instance;
+
+    bvh_node.aabb_min = world_bounds.get_aabb_min(first);
+    bvh_node.aabb_max = world_bounds.get_aabb_max(first);
+
+    for (uint32_t slot = first + 1; slot < first + bvh_node.instance_count;
+         slot++) {
+      bvh_node.aabb_min =
+        glm::min(bvh_node.aabb_min, world_bounds.get_aabb_min(slot));
+      bvh_node.aabb_max =
+        glm::max(bvh_node.aabb_max, world_bounds.get_aabb_max(slot));
+    }
+  }
+}
+
+enum class CULL_RESULT : uint8_t
+{
+  OUTSIDE,
+  INTERSECTS,
+  INSIDE
+};
+
+auto
+cull_aabb(const Frustum&   frustum,
+          const glm::vec3& aabb_min,
+          const glm::vec3& aabb_max) -> CULL_RESULT
+{
+  CULL_RESULT result = CULL_RESULT::INSIDE;
+
+  for (const glm::vec4& plane : frustum.planes) {
+    // corners furthest along and against the plane normal
+    const glm::vec3 positive{ plane.x >= 0.f ? aabb_max.x : aabb_min.x,
+                              plane.y >= 0.f ? aabb_max.y : aabb_min.y,
+                              plane.z >= 0.f ? aabb_max.z : aabb_min.z };
+    const glm::vec3 negative{ plane.x >= 0.f ? aabb_min.x : aabb_max.x,
+                              plane.y >= 0.f ? aabb_min.y : aabb_max.y,
+                              plane.z >= 0.f ? aabb_min.z : aabb_max.z };
+
+    if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z +
+          plane.w <
+        0.f) {
+      return CULL_RESULT::OUTSIDE;
+    }
+
+    if (plane.x * negative.x + plane.y * negative.y + plane.z * negative.z +
+          plane.w <
+        0.f) {
+      result = CULL_RESULT::INTERSECTS;
+    }
+  }
+
+  return result;
+}
+
+void
+SceneBvh::query_frustum(const Frustum&             frustum,
+                        std::vector<MeshInstance>& out_instances) const
+{
+  if (bvh_nodes.empty()) {
+    return;
+  }
+
+  std::vector<uint32_t> node_stack = { 0 };
+
+  while (!node_stack.empty()) {
+    const SceneBvhNode& bvh_node = bvh_nodes[node_stack.back()];
+    node_stack.pop_back();
+
+    const CULL_RESULT result =
+      cull_aabb(frustum, bvh_node.aabb_min, bvh_node.aabb_max);
+
+    if (result == CULL_RESULT::OUTSIDE) {
+      continue;
+    }
+
+    const uint32_t first = bvh_node.first_instance;
+    const uint32_t last  = first + bvh_node.instance_count;
+
+    // a subtree fully inside needs no further tests
+    if (result == CULL_RESULT::INSIDE) {
+      out_instances.insert(out_instances.end(),
+                           instances.begin() + first,
+                           instances.begin() + last);
+      continue;
+    }
+
+    if (bvh_node.left_child != 0) {
+      node_stack.push_back(bvh_node.left_child + 1);
+      node_stack.push_back(bvh_node.left_child);
+      continue;
+    }
+
+    for (uint32_t slot = first; slot < last; slot++) {
+      if (cull_aabb(frustum,
+                    world_bounds.get_aabb_min(slot),
+                    world_bounds.get_aabb_max(slot)) != CULL_RESULT::OUTSIDE) {
+        out_instances.push_back(instances[slot]);
+      }
+    }
+  }
+}
+
+void
+SceneBvh::cull(const Frustum& frustum, std::vector<uint32_t>& out_visible) const
+{
+  world_bounds.cull(frustum, out_visible);
+}
+
+} // namespace pxd::ass
@@ -0,0 +1,322 @@
+#include "simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace pxd::ass {
+
+void
+copy_indices_with_offset(const uint8_t* source,
+                         uint32_t*      destination,
+                         size_t         count,
+                         uint32_t       offset)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i offset_v = _mm256_set1_epi32(static_cast<int>(offset));
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i packed =
+      _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i));
+    __m256i wide = _mm256_cvtepu8_epi32(packed);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+                        _mm256_add_epi32(wide, offset_v));
+  }
+#endif
+
+  for (; i < count; i++) {
+    destination[i] = source[i] + offset;
+  }
+}
+
+void
+copy_indices_with_offset(const uint16_t* source,
+                         uint32_t*       destination,
+                         size_t          count,
+                         uint32_t        offset)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i offset_v = _mm256_set1_epi32(static_cast<int>(offset));
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i packed =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+    __m256i wide = _mm256_cvtepu16_epi32(packed);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+                        _mm256_add_epi32(wide, offset_v));
+  }
+#endif
+
+  for (; i < count; i++) {
+    destination[i] = source[i] + offset;
+  }
+}
+
+void
+copy_indices_with_offset(const uint32_t* source,
+                         uint32_t*       destination,
+                         size_t          count,
+                         uint32_t        offset)
+{
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256i offset_v = _mm256_set1_epi32(static_cast<int>(offset));
+
+  for (; i + 8 <= count; i += 8) {
+    __m256i wide =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+                        _mm256_add_epi32(wide, offset_v));
+  }
+#endif
+
+  for (; i < count; i++) {
+    destination[i] = source[i] + offset;
+  }
+}
+
+void
+multiply_mat4(const float* lhs, const float* rhs, float* out)
+{
+#if defined(__AVX2__)
+  // every lhs column is broadcast to both halves, so two result columns are
+  // produced per iteration
+  const __m256 l0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs));
+  const __m256 l1 =
+    _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs + 4));
+  const __m256 l2 =
+    _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs + 8));
+  const __m256 l3 =
+    _mm256_broadcast_ps(reinterpret_cast<const __m128*>(lhs + 12));
+
+  for (int column = 0; column < 4; column += 2) {
+    const __m256 r = _mm256_loadu_ps(rhs + column * 4);
+
+    __m256 result = _mm256_mul_ps(l0, _mm256_shuffle_ps(r, r, 0x00));
+    result =
+      _mm256_add_ps(result, _mm256_mul_ps(l1, _mm256_shuffle_ps(r, r, 0x55)));
+    result =
+      _mm256_add_ps(result, _mm256_mul_ps(l2, _mm256_shuffle_ps(r, r, 0xAA)));
+    result =
+      _mm256_add_ps(result, _mm256_mul_ps(l3, _mm256_shuffle_ps(r, r, 0xFF)));
+
+    _mm256_storeu_ps(out + column * 4, result);
+  }
+#else
+  float result[16];
+
+  for (int column = 0; column < 4; column++) {
+    for (int row = 0; row < 4; row++) {
+      result[column * 4 + row] = lhs[row] * rhs[column * 4] +
+                                 lhs[4 + row] * rhs[column * 4 + 1] +
+                                 lhs[8 + row] * rhs[column * 4 + 2] +
+                                 lhs[12 + row] * rhs[column * 4 + 3];
+    }
+  }
+
+  for (int i = 0; i < 16; i++) {
+    out[i] = result[i];
+  }
+#endif
+}
+
+void
+min_max_points(const float* points,
+               size_t       count,
+               size_t       stride,
+               float*       out_min,
+               float*       out_max)
+{
+  float min_v[3] = { points[0], points[1], points[2] };
+  float max_v[3] = { points[0], points[1], points[2] };
+
+  size_t i = 0;
+
+#if defined(__AVX2__)
+  if (stride == 4 && count >= 2) {
+    // two points per register, lanes 3 and 7 hold padding and are dropped
+    __m256 min_r = _mm256_loadu_ps(points);
+    __m256 max_r = min_r;
+
+    for (i = 2; i + 2 <= count; i += 2) {
+      const __m256 p = _mm256_loadu_ps(points + i * 4);
+
+      min_r = _mm256_min_ps(min_r, p);
+      max_r = _mm256_max_ps(max_r, p);
+    }
+
+    alignas(16) float min_lanes[4];
+    alignas(16) float max_lanes[4];
+
+    _mm_store_ps(min_lanes,
+                 _mm_min_ps(_mm256_castps256_ps128(min_r),
+                            _mm256_extractf128_ps(min_r, 1)));
+    _mm_store_ps(max_lanes,
+                 _mm_max_ps(_mm256_castps256_ps128(max_r),
+                            _mm256_extractf128_ps(max_r, 1)));
+
+    for (int c = 0; c < 3; c++) {
+      min_v[c] = min_lanes[c];
+      max_v[c] = max_lanes[c];
+    }
+  } else if (stride == 3 && count >= 8) {
+    // eight packed points span three registers, lane k of register r always
+    // holds component (8 * r + k) % 3
+    __m256 min_r[3] = { _mm256_loadu_ps(points),
+                        _mm256_loadu_ps(points + 8),
+                        _mm256_loadu_ps(points + 16) };
+    __m256 max_r[3] = { min_r[0], min_r[1], min_r[2] };
+
+    for (i = 8; i + 8 <= count; i += 8) {
+      for (int r = 0; r < 3; r++) {
+        const __m256 p = _mm256_loadu_ps(points + i * 3 + r * 8);
+
+        min_r[r] = _mm256_min_ps(min_r[r], p);
+        max_r[r] = _mm256_max_ps(max_r[r], p);
+      }
+    }
+
+    alignas(32) float min_lanes[24];
+    alignas(32) float max_lanes[24];
+
+    for (int r = 0; r < 3; r++) {
+      _mm256_store_ps(min_lanes + r * 8, min_r[r]);
+      _mm256_store_ps(max_lanes + r * 8, max_r[r]);
+    }
+
+    for (int k = 0; k < 24; k++) {
+      min_v[k % 3] = std::min(min_v[k % 3], min_lanes[k]);
+      max_v[k % 3] = std::max(max_v[k % 3], max_lanes[k]);
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    for (int c = 0; c < 3; c++) {
+      min_v[c] = std::min(min_v[c], points[i * stride + c]);
+      max_v[c] = std::max(max_v[c], points[i * stride + c]);
+    }
+  }
+
+  for (int c = 0; c < 3; c++) {
+    out_min[c] = min_v[c];
+    out_max[c] = max_v[c];
+  }
+}
+
+auto
+frustum_cull(const float*      planes,
+             const CullBounds& bounds,
+             size_t            count,
+             uint32_t*         out_indices) -> size_t
+{
+  size_t visible_count = 0;
+  size_t i             = 0;
+
+#if defined(__AVX2__)
+  const __m256 zero     = _mm256_setzero_ps();
+  const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+  for (; i < count; i += 8) {
+    const __m256 sx = _mm256_loadu_ps(bounds.sphere_x + i);
+    const __m256 sy = _mm256_loadu_ps(bounds.sphere_y + i);
+    const __m256 sz = _mm256_loadu_ps(bounds.sphere_z + i);
+    const __m256 sr = _mm256_loadu_ps(bounds.sphere_radius + i);
+    const __m256 cx = _mm256_loadu_ps(bounds.aabb_center_x + i);
+    const __m256 cy = _mm256_loadu_ps(bounds.aabb_center_y + i);
+    const __m256 cz = _mm256_loadu_ps(bounds.aabb_center_z + i);
+    const __m256 ex = _mm256_loadu_ps(bounds.aabb_extent_x + i);
+    const __m256 ey = _mm256_loadu_ps(bounds.aabb_extent_y + i);
+    const __m256 ez = _mm256_loadu_ps(bounds.aabb_extent_z + i);
+
+    __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    for (int p = 0; p < 6; p++) {
+      const __m256 nx = _mm256_set1_ps(planes[p * 4]);
+      const __m256 ny = _mm256_set1_ps(planes[p * 4 + 1]);
+      const __m256 nz = _mm256_set1_ps(planes[p * 4 + 2]);
+      const __m256 d  = _mm256_set1_ps(planes[p * 4 + 3]);
+
+      // signed distance of the sphere center plus its radius
+      __m256 sphere_distance = _mm256_add_ps(_mm256_mul_ps(nx, sx), d);
+      sphere_distance = _mm256_add_ps(sphere_distance, _mm256_mul_ps(ny, sy));
+      sphere_distance = _mm256_add_ps(sphere_distance, _mm256_mul_ps(nz, sz));
+      sphere_distance = _mm256_add_ps(sphere_distance, sr);
+
+      // signed distance of the aabb center plus its projected extent
+      __m256 aabb_distance = _mm256_add_ps(_mm256_mul_ps(nx, cx), d);
+      aabb_distance = _mm256_add_ps(aabb_distance, _mm256_mul_ps(ny, cy));
+      aabb_distance = _mm256_add_ps(aabb_distance, _mm256_mul_ps(nz, cz));
+      aabb_distance = _mm256_add_ps(
+        aabb_distance, _mm256_mul_ps(_mm256_and_ps(nx, abs_mask), ex));
+      aabb_distance = _mm256_add_ps(
+        aabb_distance, _mm256_mul_ps(_mm256_and_ps(ny, abs_mask), ey));
+      aabb_distance = _mm256_add_ps(
+        aabb_distance, _mm256_mul_ps(_mm256_and_ps(nz, abs_mask), ez));
+
+      visible = _mm256_and_ps(
+        visible, _mm256_cmp_ps(sphere_distance, zero, _CMP_GE_OQ));
+      visible =
+        _mm256_and_ps(visible, _mm256_cmp_ps(aabb_distance, zero, _CMP_GE_OQ));
+
+      if (_mm256_testz_ps(visible, visible)) {
+        break;
+      }
+    }
+
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(visible));
+
+    if (count - i < 8) {
+      mask &= (1u << (count - i)) - 1;
+    }
+
+    while (mask != 0) {
+      out_indices[visible_count++] =
+        static_cast<uint32_t>(i + std::countr_zero(mask));
+      mask &= mask - 1;
+    }
+  }
+#else
+  for (; i < count; i++) {
+    bool visible = true;
+
+    for (int p = 0; p < 6 && visible; p++) {
+      const float* plane = planes + p * 4;
+
+      const float sphere_distance = plane[0] * bounds.sphere_x[i] +
+                                    plane[1] * bounds.sphere_y[i] +
+                                    plane[2] * bounds.sphere_z[i] + plane[3] +
+                                    bounds.sphere_radius[i];
+      const float aabb_distance =
+        plane[0] * bounds.aabb_center_x[i] +
+        plane[1] * bounds.aabb_center_y[i] +
+        plane[2] * bounds.aabb_center_z[i] + plane[3] +
+        std::abs(plane[0]) * bounds.aabb_extent_x[i] +
+        std::abs(plane[1]) * bounds.aabb_extent_y[i] +
+        std::abs(plane[2]) * bounds.aabb_extent_z[i];
+
+      visible = sphere_distance >= 0.f && aabb_distance >= 0.f;
+    }
+
+    if (visible) {
+      out_indices[visible_count++] = static_cast<uint32_t>(i);
+    }
+  }
+#endif
+
+  return visible_count;
+}
+
+} // namespace pxd::ass
@@ -8,7 +8,277 @@
 
 #include "absl/flat_hash_map.hpp"
 
+#include "meshoptimizer.h"
+
+#include "mesh_bvh.hpp"
+#include "parallel.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 namespace pxd::ass {
+// vertices per task when bounds are computed in parallel
+constexpr size_t BOUNDS_TASK_VERTICES = 256 * 1024;
+
+// grows the sphere io_center, io_radius just enough to also enclose the
+// sphere center, radius
+void
+merge_sphere(const glm::vec3& center,
+             float            radius,
+             glm::vec3&       io_center,
+             float&           io_radius)
+{
+  const glm::vec3 offset   = center - io_center;
+  const float     distance = glm::length(offset);
+
+  if (distance + radius <= io_radius) {
+    return;
+  }
+
+  if (distance + io_radius <= radius) {
+    io_center = center;
+    io_radius = radius;
+    return;
+  }
+
+  const float new_radius = (distance + io_radius + radius) * 0.5f;
+
+  io_center += offset * ((new_radius - io_radius) / distance);
+  io_radius = new_radius;
+}
+
+// Ritter's sphere, seeded with the diameter estimate from two farthest point
+// searches and then grown over every point that falls outside. Inputs above
+// BOUNDS_TASK_VERTICES are searched and grown in chunks over thread_count
+// workers and the chunk spheres are merged in order, so the result only
+// depends on the input.
+void
+calculate_ritter_sphere(std::span<const glm::vec3> positions,
+                        uint32_t                   thread_count,
+                        glm::vec3&                 out_center,
+                        float&                     out_radius)
+{
+  const size_t task_count =
+    (positions.size() + BOUNDS_TASK_VERTICES - 1) / BOUNDS_TASK_VERTICES;
+
+  auto get_task_points = [&](size_t task) {
+    const size_t first = task * BOUNDS_TASK_VERTICES;
+    return positions.subspan(
+      first, std::min(BOUNDS_TASK_VERTICES, positions.size() - first));
+  };
+
+  std::vector<size_t> task_farthest(task_count);
+  std::vector<float>  task_distances(task_count);
+
+  auto find_farthest = [&](const glm::vec3& from) {
+    parallel_for(task_count, thread_count, [&](size_t task) {
+      const std::span<const glm::vec3> points = get_task_points(task);
+
+      size_t farthest     = 0;
+      float  max_distance = -1.f;
+
+      for (size_t i = 0; i < points.size(); i++) {
+        const glm::vec3 d        = points[i] - from;
+        const float     distance = glm::dot(d, d);
+
+        if (distance > max_distance) {
+          farthest     = i;
+          max_distance = distance;
+        }
+      }
+
+      task_farthest[task]  = task * BOUNDS_TASK_VERTICES + farthest;
+      task_distances[task] = max_distance;
+    });
+
+    size_t best_task = 0;
+
+    for (size_t task = 1; task < task_count; task++) {
+      if (task_distances[task] > task_distances[best_task]) {
+        best_task = task;
+      }
+    }
+
+    return positions[task_farthest[best_task]];
+  };
+
+  const glm::vec3 a = find_farthest(positions[0]);
+  const glm::vec3 b = find_farthest(a);
+
+  const glm::vec3 seed_center = (a + b) * 0.5f;
+  const float     seed_radius = glm::length(b - a) * 0.5f;
+
+  std::vector<glm::vec3> task_centers(task_count, seed_center);
+  std::vector<float>     task_radii(task_count, seed_radius);
+
+  parallel_for(task_count, thread_count, [&](size_t task) {
+    glm::vec3& center = task_centers[task];
+    float&     radius = task_radii[task];
+
+    for (const glm::vec3& p : get_task_points(task)) {
+      const float distance = glm::length(p - center);
+
+      if (distance > radius) {
+        const float new_radius = (radius + distance) * 0.5f;
+
+        center += (p - center) * ((new_radius - radius) / distance);
+        radius  = new_radius;
+      }
+    }
+  });
+
+  out_center = task_centers[0];
+  out_radius = task_radii[0];
+
+  for (size_t task = 1; task < task_count; task++) {
+    merge_sphere(task_centers[task], task_radii[task], out_center, out_radius);
+  }
+}
+
+// sphere around bounds' aabb, replaced by Ritter's sphere when that one is
+// smaller
+void
+fit_bounding_sphere(std::span<const glm::vec3> positions,
+                    uint32_t                   thread_count,
+                    bool                       tight_sphere,
+                    Bounds&                    bounds)
+{
+  bounds.sphere_center = (bounds.aabb_min + bounds.aabb_max) * 0.5f;
+  bounds.sphere_radius = glm::length(bounds.aabb_max - bounds.aabb_min) / 2.f;
+
+  if (!tight_sphere || positions.empty()) {
+    return;
+  }
+
+  glm::vec3 center;
+  float     radius;
+  calculate_ritter_sphere(positions, thread_count, center, radius);
+
+  if (radius < bounds.sphere_radius) {
+    bounds.sphere_center = center;
+    bounds.sphere_radius = radius;
+  }
+}
+
+Bounds
+calculate_bounds(std::span<const glm::vec3> positions,
+                 uint32_t                   thread_count,
+                 bool                       tight_sphere)
+{
+  Bounds bounds{};
+
+  if (positions.empty()) {
+    return bounds;
+  }
+
+  constexpr size_t stride = sizeof(glm::vec3) / sizeof(float);
+
+  const size_t task_count =
+    (positions.size() + BOUNDS_TASK_VERTICES - 1) / BOUNDS_TASK_VERTICES;
+
+  std::vector<glm::vec3> task_min(task_count);
+  std::vector<glm::vec3> task_max(task_count);
+
+  parallel_for(task_count, thread_count, [&](size_t task) {
+    const size_t first = task * BOUNDS_TASK_VERTICES;
+    const size_t count =
+      std::min(BOUNDS_TASK_VERTICES, positions.size() - first);
+
+    min_max_points(
+      &positions[first].x, count, stride, &task_min[task].x, &task_max[task].x);
+  });
+
+  bounds.aabb_min = task_min[0];
+  bounds.aabb_max = task_max[0];
+
+  for (size_t task = 1; task < task_count; task++) {
+    bounds.aabb_min = glm::min(bounds.aabb_min, task_min[task]);
+    bounds.aabb_max = glm::max(bounds.aabb_max, task_max[task]);
+  }
+
+  fit_bounding_sphere(positions, thread_count, tight_sphere, bounds);
+
+  return bounds;
+}
+
+void
+calculate_mesh_bounds(std::span<Mesh> meshes,
+                      uint32_t        thread_count,
+                      bool            tight_sphere)
+{
+  parallel_for(meshes.size(), thread_count, [&](size_t i) {
+    if (meshes[i].positions.size() <= BOUNDS_TASK_VERTICES) {
+      meshes[i].calculate_bounds(1, tight_sphere);
+    }
+  });
+
+  for (Mesh& mesh : meshes) {
+    if (mesh.positions.size() > BOUNDS_TASK_VERTICES) {
+      mesh.calculate_bounds(thread_count, tight_sphere);
+    }
+  }
+}
+
+void
+Mesh::calculate_bounds(uint32_t thread_count, bool tight_sphere)
+{
+  if (submeshes.empty()) {
+    bounds = pxd::ass::calculate_bounds(positions, thread_count, tight_sphere);
+    return;
+  }
+
+  const std::span<const glm::vec3> all_positions = positions;
+
+  for (SubMesh& submesh : submeshes) {
+    submesh.bounds = pxd::ass::calculate_bounds(
+      all_positions.subspan(submesh.vertex_offset, submesh.vertex_count),
+      thread_count,
+      tight_sphere);
+  }
+
+  // the aabb and the tight sphere are merged from the submeshes, so no
+  // position is visited twice. Empty submeshes have zero bounds at the
+  // origin and are left out of the merge.
+  const auto first = std::find_if(
+    submeshes.begin(), submeshes.end(), [](const SubMesh& submesh) {
+      return submesh.vertex_count > 0;
+    });
+
+  if (first == submeshes.end()) {
+    bounds = {};
+    return;
+  }
+
+  bounds = first->bounds;
+
+  glm::vec3 merged_center = first->bounds.sphere_center;
+  float     merged_radius = first->bounds.sphere_radius;
+
+  for (auto it = first + 1; it != submeshes.end(); it++) {
+    if (it->vertex_count == 0) {
+      continue;
+    }
+
+    bounds.aabb_min = glm::min(bounds.aabb_min, it->bounds.aabb_min);
+    bounds.aabb_max = glm::max(bounds.aabb_max, it->bounds.aabb_max);
+
+    merge_sphere(it->bounds.sphere_center,
+                 it->bounds.sphere_radius,
+                 merged_center,
+                 merged_radius);
+  }
+
+  bounds.sphere_center = (bounds.aabb_min + bounds.aabb_max) * 0.5f;
+  bounds.sphere_radius = glm::length(bounds.aabb_max - bounds.aabb_min) / 2.f;
+
+  if (tight_sphere && merged_radius < bounds.sphere_radius) {
+    bounds.sphere_center = merged_center;
+    bounds.sphere_radius = merged_radius;
+  }
+}
+
 std::vector<Vertex>
 Mesh::get_AoS()
 {
@@ -45,6 +315,9 @@ Mesh::from_AoS(std::vector<Vertex>& vertices)
     normals[i]   = vertices[i].normal;
     uvs[i]       = vertices[i].uv;
   }
+
+  // the vertices come back reordered together with rewritten indices
+  invalidate_connectivity();
 }
 
 void
@@ -66,150 +339,842 @@ Mesh::calculate_triangles()
   }
 }
 
-struct QuadTriangle
+// undirected edge key, the smaller vertex index goes in the high half
+auto
+pack_edge(uint32_t a, uint32_t b) -> uint64_t
+{
+  return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+// triangles per task when the connectivity build runs in parallel
+constexpr size_t CONNECTIVITY_TASK_TRIANGLES = 64 * 1024;
+
+struct EdgeEntry
 {
-  Triangle              main_triangle;
-  std::vector<Triangle> adjacent_triangles;
+  uint64_t key;
+  uint32_t half_edge;
 };
 
-bool
-is_adjacent(Triangle& a, Triangle& b)
+const MeshConnectivity&
+Mesh::get_connectivity(uint32_t thread_count)
 {
-  return (
-    (a.i_0 == b.i_0 && a.i_1 == b.i_1) || (a.i_0 == b.i_0 && a.i_1 == b.i_2) ||
-    (a.i_0 == b.i_0 && a.i_2 == b.i_1) || (a.i_0 == b.i_0 && a.i_2 == b.i_2) ||
+  if (connectivity_valid) {
+    return connectivity;
+  }
+
+  const size_t half_edge_count = indices.size() / 3 * 3;
 
-    (a.i_0 == b.i_1 && a.i_1 == b.i_0) || (a.i_0 == b.i_1 && a.i_1 == b.i_2) ||
-    (a.i_0 == b.i_1 && a.i_2 == b.i_0) || (a.i_0 == b.i_1 && a.i_2 == b.i_2) ||
+  std::vector<uint32_t>& twins = connectivity.twins;
+  twins.assign(half_edge_count, INVALID_INDEX);
 
-    (a.i_0 == b.i_2 && a.i_1 == b.i_1) || (a.i_0 == b.i_2 && a.i_1 == b.i_0) ||
-    (a.i_0 == b.i_2 && a.i_2 == b.i_1) || (a.i_0 == b.i_2 && a.i_2 == b.i_0));
+  // Edges are split into partitions by key hash. Every task scatters its
+  // triangle range into the partitions, then each partition is paired on its
+  // own. Partitions are read in task order, so the pairing matches a serial
+  // build for any thread count.
+  const size_t task_count =
+    (half_edge_count / 3 + CONNECTIVITY_TASK_TRIANGLES - 1) /
+    CONNECTIVITY_TASK_TRIANGLES;
+  const uint32_t partition_count =
+    resolve_thread_count(thread_count, task_count);
+
+  std::vector<std::vector<EdgeEntry>> partitions(task_count * partition_count);
+
+  parallel_for(task_count, thread_count, [&](size_t task) {
+    const size_t first = task * CONNECTIVITY_TASK_TRIANGLES * 3;
+    const size_t last =
+      std::min(half_edge_count, first + CONNECTIVITY_TASK_TRIANGLES * 3);
+
+    for (uint32_t h = uint32_t(first); h < last; h++) {
+      const uint32_t next = MeshConnectivity::get_next(h);
+      const uint64_t key  = pack_edge(indices[h], indices[next]);
+      const size_t   partition =
+        ((key * 0x9E3779B97F4A7C15ull) >> 32) % partition_count;
+
+      partitions[task * partition_count + partition].push_back({ key, h });
+    }
+  });
+
+  parallel_for(partition_count, thread_count, [&](size_t partition) {
+    // half-edge waiting for its twin, INVALID_INDEX once the edge is paired
+    absl::flat_hash_map<uint64_t, uint32_t> open_edges;
+
+    for (size_t task = 0; task < task_count; task++) {
+      for (const EdgeEntry& entry :
+           partitions[task * partition_count + partition]) {
+        auto [it, inserted] =
+          open_edges.try_emplace(entry.key, entry.half_edge);
+
+        if (inserted || it->second == INVALID_INDEX) {
+          continue;
+        }
+
+        twins[entry.half_edge] = it->second;
+        twins[it->second]      = entry.half_edge;
+        it->second             = INVALID_INDEX;
+      }
+    }
+  });
+
+  connectivity_valid = true;
+
+  return connectivity;
 }
 
-uint32_t
-get_different_index(Triangle& a, Triangle& b)
+void
+Mesh::invalidate_connectivity()
 {
-  uint32_t diff_index = 0;
+  connectivity       = {};
+  connectivity_valid = false;
+}
 
-  if (a.i_0 == b.i_0 && a.i_1 == b.i_1) {
-    diff_index = b.i_2;
-  } else if (a.i_0 == b.i_0 && a.i_1 == b.i_2) {
-    diff_index = b.i_1;
-  } else if (a.i_0 == b.i_0 && a.i_2 == b.i_1) {
-    diff_index = b.i_2;
-  } else if (a.i_0 == b.i_0 && a.i_2 == b.i_2) {
-    diff_index = b.i_1;
-  }
+void
+Mesh::build_bvh(uint32_t thread_count)
+{
+  auto mesh_bvh = std::make_shared<MeshBvh>();
+  mesh_bvh->build(positions, indices, thread_count);
 
-  if (a.i_0 == b.i_1 && a.i_1 == b.i_0) {
-    diff_index = b.i_2;
-  } else if (a.i_0 == b.i_1 && a.i_1 == b.i_2) {
-    diff_index = b.i_0;
-  } else if (a.i_0 == b.i_1 && a.i_2 == b.i_0) {
-    diff_index = b.i_2;
-  } else if (a.i_0 == b.i_1 && a.i_2 == b.i_2) {
-    diff_index = b.i_0;
-  }
+  bvh = std::move(mesh_bvh);
+}
+
+void
+Mesh::find_boundary_edges(std::vector<uint32_t>& out_half_edges)
+{
+  const MeshConnectivity& mesh_connectivity = get_connectivity();
+
+  out_half_edges.clear();
 
-  if (a.i_0 == b.i_2 && a.i_1 == b.i_0) {
-    diff_index = b.i_1;
-  } else if (a.i_0 == b.i_2 && a.i_1 == b.i_1) {
-    diff_index = b.i_0;
-  } else if (a.i_0 == b.i_2 && a.i_2 == b.i_0) {
-    diff_index = b.i_1;
-  } else if (a.i_0 == b.i_2 && a.i_2 == b.i_1) {
-    diff_index = b.i_0;
+  for (uint32_t h = 0; h < mesh_connectivity.twins.size(); h++) {
+    if (mesh_connectivity.is_boundary(h)) {
+      out_half_edges.push_back(h);
+    }
   }
+}
 
-  return diff_index;
+auto
+get_face_normal(const std::vector<glm::vec3>& positions, const Triangle& t)
+  -> glm::vec3
+{
+  return glm::cross(positions[t.i_1] - positions[t.i_0],
+                    positions[t.i_2] - positions[t.i_0]);
+}
+
+// cosine between two unnormalized face normals, degenerate faces rank last
+auto
+get_face_cosine(const glm::vec3& a, const glm::vec3& b) -> float
+{
+  float length_product = std::sqrt(glm::dot(a, a) * glm::dot(b, b));
+
+  return length_product > 0.f ? glm::dot(a, b) / length_product : -1.f;
 }
 
 void
-fill_quad_triangles(const std::vector<Triangle>& triangles,
-                    std::vector<QuadTriangle>&   quad_triangles)
+Mesh::calculate_quads()
 {
-  const size_t triangle_size = triangles.size();
+  // triangles and connectivity both come from the current indices, a cached
+  // triangle list could be left over from before indices were rewritten
+  calculate_triangles();
 
-  for (int i = 0; i < triangle_size; i++) {
-    QuadTriangle qt;
-    qt.main_triangle = triangles[i];
+  quads.clear();
+
+  const MeshConnectivity& mesh_connectivity = get_connectivity();
+  const uint32_t triangle_count = static_cast<uint32_t>(triangles.size());
+
+  // every triangle pairs with its most coplanar neighbour, near ties go to
+  // the longest shared edge so a quad is split along its diagonal. The
+  // half-edge of the chosen edge is kept.
+  constexpr float COPLANAR_TOLERANCE = 1e-3f;
 
-    for (int j = 0; j < triangle_size; j++) {
-      Triangle tri = triangles[j];
+  std::vector<uint32_t> best_edges(triangle_count, INVALID_INDEX);
 
-      if (qt.main_triangle == tri || !is_adjacent(qt.main_triangle, tri)) {
+  for (uint32_t t = 0; t < triangle_count; t++) {
+    const glm::vec3 normal       = get_face_normal(positions, triangles[t]);
+    float           best_cosine  = -2.f;
+    float           best_length2 = 0.f;
+
+    for (uint32_t h = 3 * t; h < 3 * t + 3; h++) {
+      if (mesh_connectivity.is_boundary(h)) {
         continue;
       }
 
-      qt.adjacent_triangles.push_back(tri);
+      const uint32_t neighbor =
+        MeshConnectivity::get_triangle(mesh_connectivity.twins[h]);
+
+      const glm::vec3 neighbor_normal =
+        get_face_normal(positions, triangles[neighbor]);
+      const uint32_t  next = MeshConnectivity::get_next(h);
+      const glm::vec3 edge = positions[indices[next]] - positions[indices[h]];
+
+      const float cosine  = get_face_cosine(normal, neighbor_normal);
+      const float length2 = glm::dot(edge, edge);
+
+      if (cosine > best_cosine + COPLANAR_TOLERANCE ||
+          (cosine >= best_cosine - COPLANAR_TOLERANCE &&
+           length2 > best_length2)) {
+        best_edges[t] = h;
+        best_cosine   = std::max(best_cosine, cosine);
+        best_length2  = length2;
+      }
+    }
+  }
+
+  for (uint32_t t = 0; t < triangle_count; t++) {
+    if (best_edges[t] == INVALID_INDEX) {
+      continue;
     }
 
-    quad_triangles.push_back(qt);
+    const uint32_t twin       = mesh_connectivity.twins[best_edges[t]];
+    const uint32_t best_match = MeshConnectivity::get_triangle(twin);
+    const uint32_t opposite =
+      MeshConnectivity::get_next(MeshConnectivity::get_next(twin));
+
+    // a pair chosen from both sides is emitted by its first triangle only
+    if (best_match < t && best_edges[best_match] == twin) {
+      continue;
+    }
+
+    Quad q;
+    q.i_0 = triangles[t].i_0;
+    q.i_1 = triangles[t].i_1;
+    q.i_2 = triangles[t].i_2;
+    q.i_3 = indices[opposite];
+    q.t1  = triangles[t];
+    q.t2  = triangles[best_match];
+
+    quads.push_back(q);
   }
 }
 
-std::string
-get_quad_string(Quad& q)
+auto
+get_position_size(POSITION_FORMAT format) -> uint32_t
 {
-  uint32_t index[4] = { q.i_0, q.i_1, q.i_2, q.i_3 };
-  std::sort(index, index + 4);
+  return format == POSITION_FORMAT::FLOAT32 ? 3 * sizeof(float)
+                                            : 4 * sizeof(uint16_t);
+}
 
-  return fmt::format("{}_{}_{}_{}", index[0], index[1], index[2], index[3]);
+auto
+get_normal_size(NORMAL_FORMAT format) -> uint32_t
+{
+  return format == NORMAL_FORMAT::FLOAT32 ? 3 * sizeof(float)
+                                          : 2 * sizeof(uint16_t);
+}
+
+auto
+get_uv_size(UV_FORMAT format) -> uint32_t
+{
+  return format == UV_FORMAT::FLOAT32 ? 2 * sizeof(float)
+                                      : 2 * sizeof(uint16_t);
+}
+
+// maps a unit vector onto the octahedron and unfolds the lower half over the
+// upper one, the result is in [-1, 1]
+auto
+encode_octahedral(glm::vec3 n) -> glm::vec2
+{
+  float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+
+  if (length == 0.f) {
+    return glm::vec2{ 0.f };
+  }
+
+  float x = n.x / length;
+  float y = n.y / length;
+
+  if (n.z < 0.f) {
+    float folded_x = (1.f - std::abs(y)) * (x >= 0.f ? 1.f : -1.f);
+    float folded_y = (1.f - std::abs(x)) * (y >= 0.f ? 1.f : -1.f);
+
+    x = folded_x;
+    y = folded_y;
+  }
+
+  return glm::vec2{ x, y };
+}
+
+// scale that maps extent onto [0, 1], degenerate axes collapse to 0
+auto
+get_inverse_extent(float extent) -> float
+{
+  return extent > 0.f ? 1.f / extent : 0.f;
+}
+
+PackedVertices
+Mesh::pack_vertices(const VertexFormat& format) const
+{
+  PackedVertices packed;
+  packed.format = format;
+
+  packed.position_offset = 0;
+  packed.normal_offset   = get_position_size(format.position);
+  packed.uv_offset = packed.normal_offset + get_normal_size(format.normal);
+  packed.stride    = packed.uv_offset + get_uv_size(format.uv);
+
+  const glm::vec3 aabb_extent = bounds.aabb_max - bounds.aabb_min;
+
+  if (format.position == POSITION_FORMAT::HALF) {
+    packed.position_origin = (bounds.aabb_min + bounds.aabb_max) * 0.5f;
+  } else if (format.position == POSITION_FORMAT::UNORM16) {
+    packed.position_origin = bounds.aabb_min;
+    packed.position_scale  = aabb_extent;
+  }
+
+  if (format.uv == UV_FORMAT::UNORM16 && !uvs.empty()) {
+    glm::vec2 uv_min = uvs[0];
+    glm::vec2 uv_max = uvs[0];
+
+    for (const glm::vec2& uv : uvs) {
+      uv_min = glm::min(uv_min, uv);
+      uv_max = glm::max(uv_max, uv);
+    }
+
+    packed.uv_origin = uv_min;
+    packed.uv_scale  = uv_max - uv_min;
+  }
+
+  const glm::vec3 position_inverse_scale{
+    get_inverse_extent(packed.position_scale.x),
+    get_inverse_extent(packed.position_scale.y),
+    get_inverse_extent(packed.position_scale.z),
+  };
+  const glm::vec2 uv_inverse_scale{
+    get_inverse_extent(packed.uv_scale.x),
+    get_inverse_extent(packed.uv_scale.y),
+  };
+
+  const size_t total_vertices = positions.size();
+  packed.data.resize(total_vertices * packed.stride);
+
+  for (size_t i = 0; i < total_vertices; i++) {
+    uint8_t* vertex = packed.data.data() + i * packed.stride;
+
+    glm::vec3 pos = positions[i] - packed.position_origin;
+
+    switch (format.position) {
+      case POSITION_FORMAT::FLOAT32: {
+        const float v[3] = { pos.x, pos.y, pos.z };
+        std::memcpy(vertex + packed.position_offset, v, sizeof(v));
+        break;
+      }
+      case POSITION_FORMAT::HALF: {
+        const uint16_t v[4] = { meshopt_quantizeHalf(pos.x),
+                                meshopt_quantizeHalf(pos.y),
+                                meshopt_quantizeHalf(pos.z),
+                                0 };
+        std::memcpy(vertex + packed.position_offset, v, sizeof(v));
+        break;
+      }
+      case POSITION_FORMAT::UNORM16: {
+        pos *= position_inverse_scale;
+
+        const uint16_t v[4] = {
+          static_cast<uint16_t>(meshopt_quantizeUnorm(pos.x, 16)),
+          static_cast<uint16_t>(meshopt_quantizeUnorm(pos.y, 16)),
+          static_cast<uint16_t>(meshopt_quantizeUnorm(pos.z, 16)),
+          0
+        };
+        std::memcpy(vertex + packed.position_offset, v, sizeof(v));
+        break;
+      }
+    }
+
+    glm::vec3 normal = normals[i];
+
+    switch (format.normal) {
+      case NORMAL_FORMAT::FLOAT32: {
+        const float v[3] = { normal.x, normal.y, normal.z };
+        std::memcpy(vertex + packed.normal_offset, v, sizeof(v));
+        break;
+      }
+      case NORMAL_FORMAT::OCTAHEDRAL: {
+        glm::vec2 oct = encode_octahedral(normal);
+
+        const int16_t v[2] = {
+          static_cast<int16_t>(meshopt_quantizeSnorm(oct.x, 16)),
+          static_cast<int16_t>(meshopt_quantizeSnorm(oct.y, 16)),
+        };
+        std::memcpy(vertex + packed.normal_offset, v, sizeof(v));
+        break;
+      }
+    }
+
+    glm::vec2 uv = uvs[i] - packed.uv_origin;
+
+    switch (format.uv) {
+      case UV_FORMAT::FLOAT32: {
+        const float v[2] = { uv.x, uv.y };
+        std::memcpy(vertex + packed.uv_offset, v, sizeof(v));
+        break;
+      }
+      case UV_FORMAT::HALF: {
+        const uint16_t v[2] = { meshopt_quantizeHalf(uv.x),
+                                meshopt_quantizeHalf(uv.y) };
+        std::memcpy(vertex + packed.uv_offset, v, sizeof(v));
+        break;
+      }
+      case UV_FORMAT::UNORM16: {
+        uv *= uv_inverse_scale;
+
+        const uint16_t v[2] = {
+          static_cast<uint16_t>(meshopt_quantizeUnorm(uv.x, 16)),
+          static_cast<uint16_t>(meshopt_quantizeUnorm(uv.y, 16)),
+        };
+        std::memcpy(vertex + packed.uv_offset, v, sizeof(v));
+        break;
+      }
+    }
+  }
+
+  return packed;
+}
+
+// Index and vertex ranges that lods and meshlets are built for, one per
+// submesh or a single one over the whole mesh when it has none. A range whose
+// indices leave its vertex range falls back to every vertex of the mesh.
+auto
+get_build_ranges(const Mesh& mesh) -> std::vector<SubMesh>
+{
+  const uint32_t total_indices  = static_cast<uint32_t>(mesh.indices.size());
+  const uint32_t total_vertices = static_cast<uint32_t>(mesh.positions.size());
+
+  std::vector<SubMesh> ranges = mesh.submeshes;
+
+  if (ranges.empty()) {
+    ranges.push_back({ .index_offset  = 0,
+                       .index_count   = total_indices,
+                       .vertex_offset = 0,
+                       .vertex_count  = total_vertices });
+  }
+
+  for (SubMesh& range : ranges) {
+    const auto first = mesh.indices.begin() + range.index_offset;
+    const auto last  = first + range.index_count;
+
+    const bool contained =
+      std::all_of(first, last, [&](uint32_t index) {
+        return index >= range.vertex_offset &&
+               index - range.vertex_offset < range.vertex_count;
+      });
+
+    if (!contained) {
+      range.vertex_offset = 0;
+      range.vertex_count  = total_vertices;
+    }
+  }
+
+  return ranges;
+}
+
+// indices of range relative to its first vertex
+auto
+get_range_indices(const Mesh& mesh, const SubMesh& range)
+  -> std::vector<uint32_t>
+{
+  std::vector<uint32_t> range_indices(
+    mesh.indices.begin() + range.index_offset,
+    mesh.indices.begin() + range.index_offset + range.index_count);
+
+  for (uint32_t& index : range_indices) {
+    index -= range.vertex_offset;
+  }
+
+  return range_indices;
 }
 
 void
-Mesh::calculate_quads()
+Mesh::generate_lods(std::span<const LodTarget> targets)
 {
-  if (triangles.empty()) {
-    calculate_triangles();
+  lods.clear();
+
+  if (indices.empty() || positions.empty()) {
+    return;
   }
 
-  std::vector<QuadTriangle> quad_triangles;
-  fill_quad_triangles(triangles, quad_triangles);
+  lods.reserve(targets.size());
 
-  const size_t                           quad_size = quad_triangles.size();
-  absl::flat_hash_map<std::string, Quad> temp_quads;
+  // every submesh runs its own chain over its own vertices, so neither
+  // triangles nor errors cross submesh borders
+  const std::vector<SubMesh> ranges = get_build_ranges(*this);
 
-  for (size_t i = 0; i < quad_size; i++) {
-    Quad         q;
-    QuadTriangle qt = quad_triangles[i];
+  std::vector<std::vector<uint32_t>> source_indices(ranges.size());
+  std::vector<float>                 chain_errors(ranges.size(), 0.f);
+  std::vector<uint32_t>              simplified;
 
-    q.i_0 = qt.main_triangle.i_0;
-    q.i_1 = qt.main_triangle.i_1;
-    q.i_2 = qt.main_triangle.i_2;
-    q.t1  = qt.main_triangle;
+  for (size_t r = 0; r < ranges.size(); r++) {
+    source_indices[r] = get_range_indices(*this, ranges[r]);
+  }
+
+  for (const LodTarget& target : targets) {
+    MeshLod lod;
+    lod.submesh_offsets.reserve(ranges.size() + 1);
+
+    bool removed_triangles = false;
+
+    for (size_t r = 0; r < ranges.size(); r++) {
+      const SubMesh&         range  = ranges[r];
+      std::vector<uint32_t>& source = source_indices[r];
+
+      const size_t source_count = source.size();
+      const size_t target_count = static_cast<size_t>(
+        static_cast<double>(range.index_count / 3) * target.triangle_ratio) * 3;
+
+      // errors of chained levels add up, so each step only gets what is left
+      // of the target error
+      const float step_budget =
+        std::max(target.target_error - chain_errors[r], 0.f);
 
-    const size_t adjacent_triangles_size = qt.adjacent_triangles.size();
-    Triangle     best_match              = Triangle();
-    float        min_dot                 = 1000.f;
+      simplified.resize(source_count);
 
-    for (size_t j = 0; j < adjacent_triangles_size; j++) {
-      Triangle adj_tri = qt.adjacent_triangles[j];
+      float  step_error  = 0.f;
+      size_t index_count = 0;
+
+      if (source_count > 0) {
+        index_count = meshopt_simplify(simplified.data(),
+                                       source.data(),
+                                       source_count,
+                                       &positions[range.vertex_offset].x,
+                                       range.vertex_count,
+                                       sizeof(glm::vec3),
+                                       target_count,
+                                       step_budget,
+                                       0,
+                                       &step_error);
+      }
+
+      // a submesh that cannot shrink any further keeps its previous level
+      if (index_count > 0 && index_count < source_count) {
+        simplified.resize(index_count);
+        meshopt_optimizeVertexCache(simplified.data(),
+                                    simplified.data(),
+                                    index_count,
+                                    range.vertex_count);
+
+        source.swap(simplified);
+        chain_errors[r] += step_error;
+        removed_triangles = true;
+      }
 
-      double dot_val =
-        glm::abs(glm::dot(normals[qt.main_triangle.i_0], normals[adj_tri.i_0]));
+      lod.submesh_offsets.push_back(static_cast<uint32_t>(lod.indices.size()));
 
-      if (dot_val < min_dot) {
-        best_match = adj_tri;
-        min_dot    = dot_val;
+      for (uint32_t index : source) {
+        lod.indices.push_back(index + range.vertex_offset);
       }
+
+      lod.error = std::max(lod.error, chain_errors[r]);
+    }
+
+    if (!removed_triangles) {
+      break;
     }
 
-    q.t2  = best_match;
-    q.i_3 = get_different_index(q.t1, q.t2);
+    lod.submesh_offsets.push_back(static_cast<uint32_t>(lod.indices.size()));
+    lod.indices.shrink_to_fit();
 
-    temp_quads.insert({ get_quad_string(q), q });
+    lods.push_back(std::move(lod));
   }
+}
 
-  const size_t temp_quad_size = temp_quads.size();
-  auto         it             = temp_quads.begin();
-  quads.clear();
-  quads.resize(temp_quad_size);
+void
+Mesh::build_meshlets(size_t max_vertices,
+                     size_t max_triangles,
+                     float  cone_weight)
+{
+  meshlets.clear();
+  meshlet_vertices.clear();
+  meshlet_triangles.clear();
+  meshlet_offsets.clear();
+
+  if (indices.empty() || positions.empty()) {
+    return;
+  }
+
+  // meshlets never mix triangles of different submeshes, each submesh is
+  // clustered over its own vertices and appended in order
+  const std::vector<SubMesh> ranges = get_build_ranges(*this);
+
+  std::vector<meshopt_Meshlet> built_meshlets;
+  std::vector<uint32_t>        built_vertices;
+  std::vector<uint8_t>         built_triangles;
+
+  meshlet_offsets.reserve(ranges.size() + 1);
+
+  for (const SubMesh& range : ranges) {
+    meshlet_offsets.push_back(static_cast<uint32_t>(meshlets.size()));
+
+    if (range.index_count == 0) {
+      continue;
+    }
+
+    const std::vector<uint32_t> range_indices = get_range_indices(*this, range);
+    const float* range_positions = &positions[range.vertex_offset].x;
+
+    const size_t max_meshlets = meshopt_buildMeshletsBound(
+      range_indices.size(), max_vertices, max_triangles);
+
+    built_meshlets.resize(max_meshlets);
+    built_vertices.resize(max_meshlets * max_vertices);
+    built_triangles.resize(max_meshlets * max_triangles * 3);
+
+    const size_t meshlet_count = meshopt_buildMeshlets(built_meshlets.data(),
+                                                       built_vertices.data(),
+                                                       built_triangles.data(),
+                                                       range_indices.data(),
+                                                       range_indices.size(),
+                                                       range_positions,
+                                                       range.vertex_count,
+                                                       sizeof(glm::vec3),
+                                                       max_vertices,
+                                                       max_triangles,
+                                                       cone_weight);
+
+    if (meshlet_count == 0) {
+      continue;
+    }
 
-  for (int i = 0; i < temp_quad_size; i++) {
-    quads[i] = it->second;
-    it++;
+    // the triangle data of every meshlet starts 4 byte aligned
+    const meshopt_Meshlet& last = built_meshlets[meshlet_count - 1];
+
+    const uint32_t vertex_base =
+      static_cast<uint32_t>(meshlet_vertices.size());
+    const uint32_t triangle_base =
+      static_cast<uint32_t>(meshlet_triangles.size());
+
+    const size_t vertex_end = last.vertex_offset + last.vertex_count;
+
+    for (size_t v = 0; v < vertex_end; v++) {
+      meshlet_vertices.push_back(built_vertices[v] + range.vertex_offset);
+    }
+
+    meshlet_triangles.insert(meshlet_triangles.end(),
+                             built_triangles.begin(),
+                             built_triangles.begin() + last.triangle_offset +
+                               ((last.triangle_count * 3 + 3) & ~3u));
+
+    for (size_t i = 0; i < meshlet_count; i++) {
+      const meshopt_Meshlet& built = built_meshlets[i];
+
+      meshopt_Bounds bounds =
+        meshopt_computeMeshletBounds(&built_vertices[built.vertex_offset],
+                                     &built_triangles[built.triangle_offset],
+                                     built.triangle_count,
+                                     range_positions,
+                                     range.vertex_count,
+                                     sizeof(glm::vec3));
+
+      Meshlet& meshlet        = meshlets.emplace_back();
+      meshlet.vertex_offset   = vertex_base + built.vertex_offset;
+      meshlet.triangle_offset = triangle_base + built.triangle_offset;
+      meshlet.vertex_count    = built.vertex_count;
+      meshlet.triangle_count  = built.triangle_count;
+      meshlet.center =
+        glm::vec3{ bounds.center[0], bounds.center[1], bounds.center[2] };
+      meshlet.radius    = bounds.radius;
+      meshlet.cone_apex = glm::vec3{ bounds.cone_apex[0],
+                                     bounds.cone_apex[1],
+                                     bounds.cone_apex[2] };
+      meshlet.cone_axis = glm::vec3{ bounds.cone_axis[0],
+                                     bounds.cone_axis[1],
+                                     bounds.cone_axis[2] };
+      meshlet.cone_cutoff = bounds.cone_cutoff;
+    }
+  }
+
+  meshlet_offsets.push_back(static_cast<uint32_t>(meshlets.size()));
+
+  meshlets.shrink_to_fit();
+  meshlet_vertices.shrink_to_fit();
+  meshlet_triangles.shrink_to_fit();
+}
+
+// meshopt vertex codec works on tightly packed components, an aligned
+// glm::vec3 is staged through a float buffer so its padding is not encoded
+template<typename T, size_t ComponentCount>
+auto
+encode_stream(const std::vector<T>& stream) -> std::vector<uint8_t>
+{
+  constexpr size_t vertex_size = ComponentCount * sizeof(float);
+
+  const float*       source = &stream[0][0];
+  std::vector<float> staged;
+
+  if constexpr (sizeof(T) != vertex_size) {
+    staged.resize(stream.size() * ComponentCount);
+
+    for (size_t i = 0; i < stream.size(); i++) {
+      std::memcpy(&staged[i * ComponentCount], &stream[i][0], vertex_size);
+    }
+
+    source = staged.data();
+  }
+
+  std::vector<uint8_t> buffer(
+    meshopt_encodeVertexBufferBound(stream.size(), vertex_size));
+
+  buffer.resize(meshopt_encodeVertexBuffer(
+    buffer.data(), buffer.size(), source, stream.size(), vertex_size));
+  buffer.shrink_to_fit();
+
+  return buffer;
+}
+
+template<typename T, size_t ComponentCount>
+auto
+decode_stream(const std::vector<uint8_t>& buffer,
+              size_t                      vertex_count,
+              std::vector<T>&             out_stream) -> bool
+{
+  constexpr size_t vertex_size = ComponentCount * sizeof(float);
+
+  out_stream.resize(vertex_count);
+
+  if (vertex_count == 0) {
+    return true;
+  }
+
+  if constexpr (sizeof(T) == vertex_size) {
+    return meshopt_decodeVertexBuffer(&out_stream[0][0],
+                                      vertex_count,
+                                      vertex_size,
+                                      buffer.data(),
+                                      buffer.size()) == 0;
+  } else {
+    std::vector<float> staged(vertex_count * ComponentCount);
+
+    if (meshopt_decodeVertexBuffer(staged.data(),
+                                   vertex_count,
+                                   vertex_size,
+                                   buffer.data(),
+                                   buffer.size()) != 0) {
+      return false;
+    }
+
+    for (size_t i = 0; i < vertex_count; i++) {
+      std::memcpy(&out_stream[i][0], &staged[i * ComponentCount], vertex_size);
+    }
+
+    return true;
+  }
+}
+
+bool
+Mesh::is_compressed() const
+{
+  return !encoded.indices.empty() || encoded.vertex_count != 0;
+}
+
+bool
+Mesh::compress()
+{
+  if (is_compressed()) {
+    return true;
+  }
+
+  const size_t total_vertices = positions.size();
+
+  // the index codec only accepts triangle lists
+  if (indices.size() % 3 != 0 || normals.size() != total_vertices ||
+      uvs.size() != total_vertices) {
+    return false;
+  }
+
+  EncodedGeometry geometry;
+  geometry.index_count  = indices.size();
+  geometry.vertex_count = total_vertices;
+
+  if (!indices.empty()) {
+    geometry.indices.resize(
+      meshopt_encodeIndexBufferBound(indices.size(), total_vertices));
+    geometry.indices.resize(meshopt_encodeIndexBuffer(geometry.indices.data(),
+                                                      geometry.indices.size(),
+                                                      indices.data(),
+                                                      indices.size()));
+    geometry.indices.shrink_to_fit();
+  }
+
+  if (total_vertices != 0) {
+    geometry.positions = encode_stream<glm::vec3, 3>(positions);
+    geometry.normals   = encode_stream<glm::vec3, 3>(normals);
+    geometry.uvs       = encode_stream<glm::vec2, 2>(uvs);
+  }
+
+  encoded = std::move(geometry);
+
+  indices   = {};
+  positions = {};
+  normals   = {};
+  uvs       = {};
+
+  // everything derived from the released streams goes with them
+  triangles = {};
+  quads     = {};
+  invalidate_connectivity();
+  bvh.reset();
+
+  return true;
+}
+
+bool
+Mesh::decompress()
+{
+  if (!is_compressed()) {
+    return true;
   }
+
+  if (!decode_indices(indices) || !decode_positions(positions) ||
+      !decode_normals(normals) || !decode_uvs(uvs)) {
+    return false;
+  }
+
+  // everything derived from the indices was built from the pre-compress
+  // corner order, the restored indices may have each triangle rotated
+  triangles = {};
+  quads     = {};
+  invalidate_connectivity();
+  bvh.reset();
+
+  lods              = {};
+  meshlets          = {};
+  meshlet_vertices  = {};
+  meshlet_triangles = {};
+  meshlet_offsets   = {};
+
+  encoded = {};
+  return true;
+}
+
+bool
+Mesh::decode_indices(std::vector<uint32_t>& out_indices) const
+{
+  out_indices.resize(encoded.index_count);
+
+  if (encoded.index_count == 0) {
+    return true;
+  }
+
+  return meshopt_decodeIndexBuffer(out_indices.data(),
+                                   encoded.index_count,
+                                   sizeof(uint32_t),
+                                   encoded.indices.data(),
+                                   encoded.indices.size()) == 0;
+}
+
+bool
+Mesh::decode_positions(std::vector<glm::vec3>& out_positions) const
+{
+  return decode_stream<glm::vec3, 3>(
+    encoded.positions, encoded.vertex_count, out_positions);
+}
+
+bool
+Mesh::decode_normals(std::vector<glm::vec3>& out_normals) const
+{
+  return decode_stream<glm::vec3, 3>(
+    encoded.normals, encoded.vertex_count, out_normals);
+}
+
+bool
+Mesh::decode_uvs(std::vector<glm::vec2>& out_uvs) const
+{
+  return decode_stream<glm::vec2, 2>(
+    encoded.uvs, encoded.vertex_count, out_uvs);
 }
 
 }
\ No newline at end of file